@@ -0,0 +1,127 @@
+/*
+ * Measures the read throughput of CSVReader for a range of block lengths.
+ *
+ *   csv_bench [file [size_in_mib]]
+ *
+ * If the file does not exist a file with four columns and roughly the given
+ * size is generated first. Every block length is timed a few times against
+ * the warm page cache and the best run is reported.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "csv.h"
+
+namespace
+{
+
+bool generate(const char *file_name, long long size)
+{
+    FILE *file = std::fopen(file_name, "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::fputs("id,value,name,count\n", file);
+    long long written = 0;
+    for (long long i = 0; written < size; ++i)
+    {
+        int n = std::fprintf(
+            file, "%lld,%lld.%03lld,name_%lld,%lld\n",
+            i, i*7 % 100000, i % 1000, i % 4096, i % 65536);
+        if (n < 0)
+        {
+            std::fclose(file);
+            return false;
+        }
+        written += n;
+    }
+
+    return std::fclose(file) == 0;
+}
+
+bool run(const char *file_name, int block_len, long long &rows)
+{
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<4> reader(err, file_name, block_len);
+    reader.read_header(err, io::ignore_no_column, "id", "value", "name", "count");
+
+    long long id;
+    double value;
+    char *name;
+    int count;
+    rows = 0;
+    while (reader.read_row(err, id, value, name, count))
+    {
+        ++rows;
+    }
+
+    if (err)
+    {
+        std::cerr << err->get_error() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // end namespace
+
+int main(int argc, char *argv[])
+{
+    const char *file_name = argc > 1 ? argv[1] : "csv_bench.csv";
+    long long size = (argc > 2 ? std::atoll(argv[2]) : 256) << 20;
+
+    FILE *file = std::fopen(file_name, "rb");
+    if (file == nullptr)
+    {
+        if (!generate(file_name, size))
+        {
+            std::cerr << "Cannot write " << file_name << std::endl;
+            return 1;
+        }
+        file = std::fopen(file_name, "rb");
+        if (file == nullptr)
+        {
+            std::cerr << "Cannot read " << file_name << std::endl;
+            return 1;
+        }
+    }
+    std::fseek(file, 0, SEEK_END);
+    size = std::ftell(file);
+    std::fclose(file);
+
+    long long rows;
+    if (!run(file_name, io::LineReader::default_block_len, rows))
+    {
+        return 1;
+    }
+
+    std::cout << "block_len  buffer      MiB/s" << std::endl;
+    for (int block_len = 1<<12; block_len <= 1<<25; block_len *= 2)
+    {
+        double best = 0;
+        for (int repeat = 0; repeat < 3; ++repeat)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (!run(file_name, block_len, rows))
+            {
+                return 1;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            double throughput = static_cast<double>(size)/(1<<20)/elapsed.count();
+            if (throughput > best)
+            {
+                best = throughput;
+            }
+        }
+
+        std::printf("%6d KiB %7d KiB %10.1f\n", block_len >> 10, 3*(block_len >> 10), best);
+    }
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Measures the cost per row of the error policies on a narrow integer file.
+ *
+ *   csv_check_bench [file [row_count]]
+ *
+ * If the file does not exist a file with four short integer columns and the
+ * given number of rows is generated first. Every variant is timed a few
+ * times against the warm page cache and the best run is reported in
+ * nanoseconds and, on x86, in time stamp counter cycles per row.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CSV_BENCH_TSC
+#endif
+
+#include "csv.h"
+
+namespace
+{
+
+bool generate(const char *file_name, long long row_count)
+{
+    FILE *file = std::fopen(file_name, "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::fputs("a,b,c,d\n", file);
+    for (long long i = 0; i < row_count; ++i)
+    {
+        if (std::fprintf(file, "%lld,%lld,%lld,%lld\n", i % 100, i*7 % 1000, i % 10, i*13 % 10000) < 0)
+        {
+            std::fclose(file);
+            return false;
+        }
+    }
+
+    return std::fclose(file) == 0;
+}
+
+unsigned long long read_cycles()
+{
+#ifdef CSV_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+template<class error_policy, class Err>
+bool run(const char *file_name, long long &rows, long long &sum)
+{
+    std::shared_ptr<io::error::error> header_err;
+    io::CSVReader<
+        4,
+        io::trim_chars<' ', '\t'>,
+        io::no_quote_escape<','>,
+        io::set_to_max_on_overflow,
+        io::no_comment,
+        error_policy> reader(header_err, file_name);
+    reader.read_header(header_err, io::ignore_no_column, "a", "b", "c", "d");
+    if (header_err)
+    {
+        std::cerr << header_err->get_error() << std::endl;
+        return false;
+    }
+
+    Err err;
+    int a = 0, b = 0, c = 0, d = 0;
+    rows = 0;
+    sum = 0;
+    while (reader.read_row(err, a, b, c, d))
+    {
+        ++rows;
+        sum += a + b + c + d;
+    }
+
+    if (err)
+    {
+        std::cerr << "Reading " << file_name << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template<class error_policy, class Err>
+bool time(const char *name, const char *file_name)
+{
+    double best_ns = 0;
+    double best_cycles = 0;
+    long long rows = 0;
+    long long sum = 0;
+    for (int repeat = 0; repeat < 5; ++repeat)
+    {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long start_cycles = read_cycles();
+        if (!run<error_policy, Err>(file_name, rows, sum) || rows == 0)
+        {
+            return false;
+        }
+        double cycles = static_cast<double>(read_cycles() - start_cycles)/static_cast<double>(rows);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double ns = elapsed.count()*1e9/static_cast<double>(rows);
+        if (repeat == 0 || ns < best_ns)
+        {
+            best_ns = ns;
+            best_cycles = cycles;
+        }
+    }
+
+    std::printf("%-30s %10.2f %10.1f   (checksum %lld)\n", name, best_ns, best_cycles, sum);
+    return true;
+}
+
+} // end namespace
+
+int main(int argc, char *argv[])
+{
+    const char *file_name = argc > 1 ? argv[1] : "csv_check_bench.csv";
+    long long row_count = argc > 2 ? std::atoll(argv[2]) : 10000000;
+
+    FILE *file = std::fopen(file_name, "rb");
+    if (file == nullptr)
+    {
+        if (!generate(file_name, row_count))
+        {
+            std::cerr << "Cannot write " << file_name << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::fclose(file);
+    }
+
+    std::cout << "policy                           ns/row cycles/row" << std::endl;
+    bool ok =
+        time<io::stop_on_error, std::shared_ptr<io::error::error>>("stop_on_error, shared_ptr", file_name) &&
+        time<io::stop_on_error, io::error::status>("stop_on_error, status", file_name) &&
+        time<io::no_error_check, io::error::status>("no_error_check, status", file_name);
+
+    return ok ? 0 : 1;
+}
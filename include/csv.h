@@ -44,16 +44,102 @@
 #include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <cfloat>
+#include <clocale>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <istream>
 #include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#if !defined(CSV_IO_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define CSV_IO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(CSV_IO_URING) && defined(__linux__)
+#define CSV_IO_URING_ENABLED
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if !defined(CSV_IO_NO_MIRROR) && defined(__linux__)
+#define CSV_IO_MIRROR
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef CSV_IO_THREAD
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#if !defined(CSV_IO_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define CSV_IO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef CSV_IO_ARROW
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+/*
+ * The structs of the Arrow C data interface, as given by its specification.
+ * The guard lets them coexist with the definitions of the Arrow libraries.
+ */
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+    const char *format;
+    const char *name;
+    const char *metadata;
+    std::int64_t flags;
+    std::int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema*);
+    void *private_data;
+};
+
+struct ArrowArray
+{
+    std::int64_t length;
+    std::int64_t null_count;
+    std::int64_t offset;
+    std::int64_t n_buffers;
+    std::int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray*);
+    void *private_data;
+};
+
+#endif
+#endif
+
 namespace io
 {
 
@@ -62,11 +148,37 @@ namespace error
 
 static constexpr int max_file_name_length = 255;
 
+/*
+ * Identifies the error classes below without allocating.
+ */
+enum class code
+{
+    none,
+    internal_error,
+    cannot_open_file,
+    cannot_write_file,
+    temporary_file_error,
+    line_length_limit_exceeded,
+    extra_column_in_header,
+    missing_column_in_header,
+    duplicated_column_in_header,
+    header_missing,
+    too_few_columns,
+    too_many_columns,
+    escaped_string_not_closed,
+    integer_must_be_positive,
+    no_digit,
+    integer_overflow,
+    integer_underflow,
+    invalid_single_character
+};
+
 class error
 {
 public:
     virtual ~error() = default;
     virtual void format_error_message() = 0;
+    virtual code get_code() const = 0;
 
     void set_file_name(const std::string &file_name_)           { file_name = file_name_; }
     void set_file_line(int file_line_)                          { file_line = file_line_;  }
@@ -97,12 +209,18 @@ private:
 class internal_error : public error
 {
 public:
+    static constexpr code error_code = code::internal_error;
+    code get_code() const override { return error_code; }
+
     void format_error_message() override {}
 };
 
 class cannot_open_file : public error
 {
 public:
+    static constexpr code error_code = code::cannot_open_file;
+    code get_code() const override { return error_code; }
+
     void format_error_message() override
     {
         std::stringstream ss;
@@ -116,21 +234,258 @@ public:
     }
 };
 
+class cannot_write_file : public error
+{
+public:
+    static constexpr code error_code = code::cannot_write_file;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Can not write file \"" << get_file_name() << "\"";
+        if (get_errno() != 0)
+        {
+            ss << " because \"" << std::strerror(get_errno()) << "\"";
+        }
+        ss << ".";
+
+        error = ss.str();
+    }
+};
+
+class temporary_file_error : public error
+{
+public:
+    static constexpr code error_code = code::temporary_file_error;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Can not use a temporary file";
+        if (get_errno() != 0)
+        {
+            ss << " because \"" << std::strerror(get_errno()) << "\"";
+        }
+        ss << ".";
+
+        error = ss.str();
+    }
+};
+
 class line_length_limit_exceeded : public error
 {
 public:
+    static constexpr code error_code = code::line_length_limit_exceeded;
+    code get_code() const override { return error_code; }
+
+    void set_max_line_length(int max_line_length_)
+    {
+        max_line_length = max_line_length_;
+    }
+
+    int get_max_line_length() const
+    {
+        return max_line_length;
+    }
+
     void format_error_message() override
     {
         std::stringstream ss;
         ss << "Line number " << get_file_line() << " in file \""
-           << get_file_name() << "\" exceeds the maximum length of 2^24-1.";
+           << get_file_name() << "\" exceeds the maximum length of "
+           << max_line_length << " characters.";
 
         error = ss.str();
     }
+
+private:
+    int max_line_length = 0;
+};
+
+/*
+ * A caller owned alternative to std::shared_ptr<error> for the row reading
+ * functions. Raising an error only stores its code and location, nothing
+ * is allocated and no message is formatted until to_error is called. The
+ * file and column name point into the reader and the column content into
+ * its buffer, so they are only valid until the next row is read.
+ */
+class status
+{
+public:
+    explicit operator bool() const
+    {
+        return error_code != code::none;
+    }
+
+    void clear()
+    {
+        *this = status();
+    }
+
+    void set_code(code error_code_)                      { error_code = error_code_; }
+    void set_file_name(const char *file_name_)           { file_name = file_name_; }
+    void set_file_line(int file_line_)                   { file_line = file_line_; }
+    void set_errno(int errno__)                          { errno_ = errno__; }
+    void set_column_name(const char *column_name_)       { column_name = column_name_; }
+    void set_column_content(const char *column_content_) { column_content = column_content_; }
+    void set_max_line_length(int max_line_length_)       { max_line_length = max_line_length_; }
+
+    code get_code() const                 { return error_code; }
+    const char *get_file_name() const     { return file_name; }
+    int get_file_line() const             { return file_line; }
+    int get_errno() const                 { return errno_; }
+    const char *get_column_name() const   { return column_name; }
+    const char *get_column_content() const{ return column_content; }
+    int get_max_line_length() const       { return max_line_length; }
+
+    /*
+     * Creates the equivalent error object with a formatted message, or
+     * returns null if there is no error.
+     */
+    std::shared_ptr<error> to_error() const;
+
+private:
+    code error_code = code::none;
+    const char *file_name = "";
+    int file_line = 0;
+    int errno_ = 0;
+    const char *column_name = "";
+    const char *column_content = "";
+    int max_line_length = 0;
 };
 
 } // end namespace error
 
+namespace detail
+{
+
+/*
+ * The functions that read rows accept either a std::shared_ptr<error> or
+ * an error::status. These overloads raise errors through both.
+ */
+template<class E>
+void raise_error(std::shared_ptr<error::error> &err)
+{
+    err = std::make_shared<E>();
+}
+
+template<class E>
+void raise_error(error::status &err)
+{
+    err.set_code(E::error_code);
+}
+
+inline void raise_internal_error(std::shared_ptr<error::error> &err, const char *message)
+{
+    err = std::make_shared<error::internal_error>();
+    err->set_error(message);
+}
+
+inline void raise_internal_error(error::status &err, const char *)
+{
+    err.set_code(error::code::internal_error);
+}
+
+inline void raise_line_length_limit_exceeded(
+    std::shared_ptr<error::error> &err,
+    int max_line_length,
+    const char *file_name,
+    int file_line)
+{
+    std::shared_ptr<error::line_length_limit_exceeded> e =
+        std::make_shared<error::line_length_limit_exceeded>();
+    e->set_max_line_length(max_line_length);
+    err = e;
+    err->set_file_name(file_name);
+    err->set_file_line(file_line);
+}
+
+inline void raise_line_length_limit_exceeded(
+    error::status &err,
+    int max_line_length,
+    const char *file_name,
+    int file_line)
+{
+    err.set_code(error::code::line_length_limit_exceeded);
+    err.set_max_line_length(max_line_length);
+    err.set_file_name(file_name);
+    err.set_file_line(file_line);
+}
+
+inline void set_error_column(std::shared_ptr<error::error> &err, const char *name, const char *content)
+{
+    err->set_column_content(content);
+    err->set_column_name(name);
+}
+
+inline void set_error_column(error::status &err, const char *name, const char *content)
+{
+    err.set_column_content(content);
+    err.set_column_name(name);
+}
+
+inline void set_error_location(std::shared_ptr<error::error> &err, const char *file_name, int file_line)
+{
+    err->set_file_name(file_name);
+    err->set_file_line(file_line);
+    err->format_error_message();
+}
+
+inline void set_error_location(error::status &err, const char *file_name, int file_line)
+{
+    err.set_file_name(file_name);
+    err.set_file_line(file_line);
+}
+
+inline error::code get_error_code(const std::shared_ptr<error::error> &err)
+{
+    return err ? err->get_code() : error::code::none;
+}
+
+inline error::code get_error_code(const error::status &err)
+{
+    return err.get_code();
+}
+
+inline void clear_error(std::shared_ptr<error::error> &err)
+{
+    err.reset();
+}
+
+inline void clear_error(error::status &err)
+{
+    err.clear();
+}
+
+static constexpr std::size_t error_code_count =
+    static_cast<std::size_t>(error::code::invalid_single_character) + 1;
+
+/*
+ * Errors that only concern the current row. The reader can continue with
+ * the next line after them.
+ */
+inline bool is_row_error(error::code c)
+{
+    switch(c)
+    {
+    case error::code::too_few_columns:
+    case error::code::too_many_columns:
+    case error::code::escaped_string_not_closed:
+    case error::code::integer_must_be_positive:
+    case error::code::no_digit:
+    case error::code::integer_overflow:
+    case error::code::integer_underflow:
+    case error::code::invalid_single_character:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // end namespace detail
+
 class ByteSourceBase
 {
 public:
@@ -163,10 +518,49 @@ public:
         return std::fread(buffer, 1, size, file);
     }
 
+    FILE *get_file() const
+    {
+        return file;
+    }
+
 private:
     FILE *file;
 };
 
+inline bool seek_file(FILE *file, long long offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#else
+    return std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+#endif
+}
+
+inline long long get_file_size(FILE *file)
+{
+#if defined(_WIN32)
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    return _ftelli64(file);
+#elif defined(__unix__) || defined(__APPLE__)
+    if (fseeko(file, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    return ftello(file);
+#else
+    if (std::fseek(file, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    return std::ftell(file);
+#endif
+}
+
 class NonOwningIStreamByteSource : public ByteSourceBase
 {
 public:
@@ -218,1205 +612,7705 @@ private:
     long long remaining_byte_count;
 };
 
-class SynchronousReader
+#ifdef CSV_IO_URING_ENABLED
+
+/*
+ * Reads a file descriptor through io_uring. Every read is split into page
+ * aligned pieces that are all queued at once and land directly in the
+ * buffer of the caller, so the device sees several large requests in
+ * flight instead of a single one.
+ */
+class OwningIoUringByteSource : public ByteSourceBase
 {
 public:
-    void init(std::unique_ptr<ByteSourceBase> arg_byte_source)
-    {
-        byte_source = std::move(arg_byte_source);
-    }
+    static constexpr unsigned queue_depth = 8;
+    static constexpr int min_piece_len = 1<<16;
+    static constexpr int page_len = 1<<12;
 
-    bool is_valid() const
-    {
-        return byte_source != nullptr;
-    }
+    OwningIoUringByteSource(const OwningIoUringByteSource&) = delete;
+    OwningIoUringByteSource&operator=(const OwningIoUringByteSource&) = delete;
 
-    void start_read(
-        char *arg_buffer,
-        int arg_desired_byte_count)
+    /*
+     * Takes ownership of fd on success. Returns null if the kernel does not
+     * provide io_uring (or it is blocked), in which case the caller should
+     * fall back to regular reads.
+     */
+    static std::unique_ptr<OwningIoUringByteSource> open(int fd)
     {
-        buffer = arg_buffer;
-        desired_byte_count = arg_desired_byte_count;
+        std::unique_ptr<OwningIoUringByteSource> source(new OwningIoUringByteSource(fd));
+        if (!source->setup_ring())
+        {
+            source->fd = -1;
+            return nullptr;
+        }
+        return source;
     }
 
-    int finish_read()
+    ~OwningIoUringByteSource()
     {
-        return byte_source->read(buffer, desired_byte_count);
+        if (sqes != MAP_FAILED)
+        {
+            munmap(sqes, sqes_len);
+        }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+        {
+            munmap(cq_ring, cq_ring_len);
+        }
+        if (sq_ring != MAP_FAILED)
+        {
+            munmap(sq_ring, sq_ring_len);
+        }
+        if (ring_fd != -1)
+        {
+            ::close(ring_fd);
+        }
+        if (fd != -1)
+        {
+            ::close(fd);
+        }
     }
 
-private:
-    std::unique_ptr<ByteSourceBase>byte_source;
-    char *buffer;
-    int desired_byte_count;
-};
-
-} // end namespace detail
+    int read(char *buffer, int size) override
+    {
+        if (size <= 0)
+        {
+            return 0;
+        }
 
-////////////////////////////////////////////////////////////////////////////
-//                               LineReader                               //
-////////////////////////////////////////////////////////////////////////////
+        int piece_len = (size + queue_depth - 1) / queue_depth;
+        piece_len = (piece_len + page_len - 1) / page_len * page_len;
+        if (piece_len < min_piece_len)
+        {
+            piece_len = min_piece_len;
+        }
+        unsigned piece_count = (size + piece_len - 1) / piece_len;
 
-class LineReader
-{
-private:
-    static const int block_len = 1<<20;
-    std::unique_ptr<char[]>buffer;
-    detail::SynchronousReader reader;
-    int data_begin;
-    int data_end;
-    char file_name[error::max_file_name_length+1];
-    unsigned file_line;
+        int results[queue_depth];
+        std::fill(results, results + queue_depth, -1);
 
-private:
-    static std::unique_ptr<ByteSourceBase> open_file(
-        const char *file_name,
-        std::shared_ptr<error::error> &err)
-    {
-        if (err)
+        if (!ring_failed)
         {
-            return nullptr;
+            for (unsigned i = 0; i < piece_count; ++i)
+            {
+                int len = std::min(piece_len, size - static_cast<int>(i)*piece_len);
+                queue_read(buffer + i*piece_len, len, file_offset + i*piece_len, i);
+            }
+            submit_and_wait(piece_count, results);
         }
 
         /*
-         * We open the file in binary mode as it makes no difference under *nix
-         * and under Windows we handle \r\n newlines ourself.
+         * Short and failed pieces are completed with pread. A piece that
+         * still comes up short has hit the end of the file.
          */
-        FILE *file = std::fopen(file_name, "rb");
-        if(file == 0)
+        int total = 0;
+        for (unsigned i = 0; i < piece_count; ++i)
         {
-            /*
-             * store errno as soon as possible, doing it after constructor
-             * call can fail.
-             */
-            int x = errno;
-            err = std::make_shared<error::cannot_open_file>();
-            err->set_errno(x);
-            err->set_file_name(file_name);
+            int len = std::min(piece_len, size - static_cast<int>(i)*piece_len);
+            int got = results[i] < 0 ? 0 : results[i];
+            while (got < len)
+            {
+                ssize_t n = pread(
+                    fd, buffer + i*piece_len + got, len - got,
+                    file_offset + i*piece_len + got);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    break;
+                }
+                got += static_cast<int>(n);
+            }
 
-            return nullptr;
+            total += got;
+            if (got < len)
+            {
+                break;
+            }
         }
 
-        return std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file));
+        file_offset += total;
+        return total;
     }
 
-    bool init(std::unique_ptr<ByteSourceBase> byte_source)
+private:
+    explicit OwningIoUringByteSource(int fd_):
+        fd(fd_)
+    {}
+
+    bool setup_ring()
     {
-        if (!byte_source)
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+        if (ring_fd < 0)
         {
+            ring_fd = -1;
             return false;
         }
 
-        file_line = 0;
-        buffer = std::unique_ptr<char[]>(new char[3*block_len]);
-        data_begin = 0;
-        data_end = byte_source->read(buffer.get(), 2*block_len);
-
-        /* Ignore UTF-8 BOM */
-        if(data_end >= 3 && buffer[0] == '\xEF' && buffer[1] == '\xBB' && buffer[2] == '\xBF')
+        sq_ring_len = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+        cq_ring_len = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
         {
-            data_begin = 3;
+            sq_ring_len = std::max(sq_ring_len, cq_ring_len);
         }
 
-        if(data_end == 2*block_len)
+        sq_ring = mmap(
+            nullptr, sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED)
         {
-            reader.init(std::move(byte_source));
-            reader.start_read(buffer.get() + 2*block_len, block_len);
+            return false;
         }
 
-        return true;
-    }
-
-public:
-    LineReader() = delete;
-    LineReader(const LineReader&) = delete;
-    LineReader&operator=(const LineReader&) = delete;
-
-    explicit LineReader(
-        std::shared_ptr<error::error> &err,
-        const char *file_name_)
-    {
-        set_file_name(file_name_);
-        init(open_file(file_name, err));
-    }
-
-    explicit LineReader(
-        std::shared_ptr<error::error> &err,
-        const std::string &file_name_)
-    {
-        set_file_name(file_name_.c_str());
-        init(open_file(file_name_.c_str(), err));
-    }
-
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const char *file_name_,
-        std::unique_ptr<ByteSourceBase> byte_source)
-    {
-        set_file_name(file_name_);
-        init(std::move(byte_source));
-    }
-
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const std::string &file_name_,
-        std::unique_ptr<ByteSourceBase> byte_source)
-    {
-        set_file_name(file_name_.c_str());
-        init(std::move(byte_source));
-    }
-
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const char *file_name_,
-        const char *data_begin_,
-        const char *data_end_)
-    {
-        set_file_name(file_name_);
-        init(std::unique_ptr<ByteSourceBase>(
-            new detail::NonOwningStringByteSource(data_begin_, data_end_-data_begin_)));
-    }
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            cq_ring = sq_ring;
+        }
+        else
+        {
+            cq_ring = mmap(
+                nullptr, cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ring == MAP_FAILED)
+            {
+                return false;
+            }
+        }
 
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const std::string &file_name_,
-        const char *data_begin_,
-        const char *data_end_)
-    {
-        set_file_name(file_name_.c_str());
-        init(std::unique_ptr<ByteSourceBase>(
-            new detail::NonOwningStringByteSource(data_begin_, data_end_-data_begin_)));
-    }
+        sqes_len = params.sq_entries*sizeof(io_uring_sqe);
+        sqes = mmap(
+            nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring_fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            return false;
+        }
 
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const char *file_name_,
-        FILE *file)
-    {
-        set_file_name(file_name_);
-        init(std::unique_ptr<ByteSourceBase>(
-            new detail::OwningStdIOByteSourceBase(file)));
-    }
+        char *sq = static_cast<char*>(sq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
 
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const std::string &file_name_,
-        FILE *file)
-    {
-        set_file_name(file_name_.c_str());
-        init(std::unique_ptr<ByteSourceBase>(
-            new detail::OwningStdIOByteSourceBase(file)));
-    }
+        char *cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
 
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const char *file_name_,
-        std::istream &in)
-    {
-        set_file_name(file_name_);
-        init(std::unique_ptr<ByteSourceBase>(
-            new detail::NonOwningIStreamByteSource(in)));
+        return true;
     }
 
-    LineReader(
-        std::shared_ptr<error::error> &,
-        const std::string &file_name_,
-        std::istream &in)
+    void queue_read(char *buffer, int len, long long offset, unsigned piece)
     {
-        set_file_name(file_name_.c_str());
-        init(std::unique_ptr<ByteSourceBase>(
-            new detail::NonOwningIStreamByteSource(in)));
+        unsigned tail = *sq_tail;
+        unsigned index = tail & sq_mask;
+
+        io_uring_sqe &sqe = static_cast<io_uring_sqe*>(sqes)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uintptr_t>(buffer);
+        sqe.len = static_cast<unsigned>(len);
+        sqe.off = static_cast<std::uint64_t>(offset);
+        sqe.user_data = piece;
+
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
     }
 
-    void set_file_name(const char *file_name_)
+    void submit_and_wait(unsigned count, int *results)
     {
-        if(file_name_ != nullptr)
+        unsigned submitted = 0;
+        while (submitted < count)
         {
-            strncpy(file_name, file_name_, sizeof(file_name));
-            file_name[sizeof(file_name)-1] = '\0';
+            long r = syscall(__NR_io_uring_enter, ring_fd, count - submitted, 0, 0, nullptr, 0);
+            if (r < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+
+                /*
+                 * The queued entries can not be taken back, so the ring is
+                 * not used again. Pieces without a result are read by pread.
+                 */
+                ring_failed = true;
+                break;
+            }
+            submitted += static_cast<unsigned>(r);
         }
-        else
+
+        unsigned reaped = 0;
+        while (reaped < submitted)
         {
-            file_name[0] = '\0';
+            unsigned head = *cq_head;
+            while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+            {
+                const io_uring_cqe &cqe = cqes[head & cq_mask];
+                results[cqe.user_data] = cqe.res;
+                ++head;
+                ++reaped;
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+            if (reaped < submitted)
+            {
+                syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            }
         }
     }
 
-    void set_file_name(const std::string &file_name_)
-    {
-        set_file_name(file_name_.c_str());
-    }
+    int fd;
+    long long file_offset = 0;
+    bool ring_failed = false;
+
+    int ring_fd = -1;
+    void *sq_ring = MAP_FAILED;
+    void *cq_ring = MAP_FAILED;
+    void *sqes = MAP_FAILED;
+    std::size_t sq_ring_len = 0;
+    std::size_t cq_ring_len = 0;
+    std::size_t sqes_len = 0;
+
+    unsigned *sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+};
 
-    const char *get_truncated_file_name() const
-    {
-        return file_name;
-    }
+#endif
 
-    void set_file_line(unsigned file_line_)
-    {
-        file_line = file_line_;
-    }
+#ifdef CSV_IO_MMAP
 
-    unsigned get_file_line() const
-    {
-        return file_line;
-    }
+/*
+ * A private, writable mapping of a whole file. Writes (the null terminators
+ * placed by LineReader) are copy-on-write and never reach the file.
+ */
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile&operator=(const MemoryMappedFile&) = delete;
 
-    char *next_line(std::shared_ptr<error::error> &err)
+    ~MemoryMappedFile()
     {
-        if (err)
+        if (data != nullptr)
         {
-            return nullptr;
+            munmap(data, size);
         }
+    }
 
-        if(data_begin == data_end)
+    /*
+     * Returns null if the file can not be mapped, in which case the caller
+     * should fall back to reading the file descriptor.
+     */
+    static std::unique_ptr<MemoryMappedFile> map(int fd)
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
         {
             return nullptr;
         }
 
-        ++file_line;
-
-        if (data_begin >= data_end)
-        {
-            err = std::make_shared<error::internal_error>();
-            err->set_error("Internal error: data_begin >= data_end");
-            return nullptr;
-        }
-        if (data_end > block_len*2)
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        if (static_cast<off_t>(size) != st.st_size)
         {
-            err = std::make_shared<error::internal_error>();
-            err->set_error("Internal error: data_end > block_len*2\n");
             return nullptr;
         }
 
-        if (data_begin >= block_len)
-        {
-            std::memcpy(buffer.get(), buffer.get()+block_len, block_len);
-            data_begin -= block_len;
-            data_end -= block_len;
-            if(reader.is_valid())
-            {
-                data_end += reader.finish_read();
-                std::memcpy(buffer.get()+block_len, buffer.get()+2*block_len, block_len);
-                reader.start_read(buffer.get() + 2*block_len, block_len);
-            }
-        }
-
-        int line_end = data_begin;
-        while(line_end != data_end && buffer[line_end] != '\n')
+        if (size == 0)
         {
-            ++line_end;
+            return std::unique_ptr<MemoryMappedFile>(new MemoryMappedFile(nullptr, 0));
         }
 
-        if(line_end - data_begin + 1 > block_len)
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
         {
-            err = std::make_shared<error::line_length_limit_exceeded>();
-            err->set_file_name(file_name);
-            err->set_file_line(file_line);
             return nullptr;
         }
 
-        if(line_end != data_end && buffer[line_end] == '\n')
-        {
-            buffer[line_end] = '\0';
-        }
-        else
-        {
-            /*
-             * Some files are missing the newline at the end of the
-             * last line
-             */
-            ++data_end;
-            buffer[line_end] = '\0';
-        }
+        madvise(data, size, MADV_SEQUENTIAL);
 
-        /*
-         * handle windows \r\n-line breaks
-         */
-        if(line_end != data_begin && buffer[line_end-1] == '\r')
-        {
-            buffer[line_end-1] = '\0';
-        }
+        return std::unique_ptr<MemoryMappedFile>(
+            new MemoryMappedFile(static_cast<char*>(data), size));
+    }
 
-        char *ret = buffer.get() + data_begin;
-        data_begin = line_end+1;
+    char *get_data() const       { return data; }
+    std::size_t get_size() const { return size; }
 
-        return ret;
-    }
+private:
+    MemoryMappedFile(char *data_, std::size_t size_):
+        data(data_),
+        size(size_)
+    {}
+
+    char *data;
+    std::size_t size;
 };
 
+#endif
+
 ////////////////////////////////////////////////////////////////////////////
-//                           CsvReader Errors                             //
+//                           Newline Scanning                             //
 ////////////////////////////////////////////////////////////////////////////
 
-namespace error
-{
+#ifdef CSV_IO_X86_SIMD
 
-constexpr int max_column_name_length = 63;
-constexpr int max_column_content_length = 63;
+/*
+ * The kernels return a bitmask of the positions of c in the 64 bytes
+ * starting at p. SSE2 is part of the x86-64 baseline, the wider variants
+ * are selected at runtime.
+ */
+using match_mask64_fn = std::uint64_t(*)(const char *p, char c);
 
-class extra_column_in_header : public error
+inline std::uint64_t match_mask64_sse2(const char *p, char c)
 {
-public:
-    void format_error_message() override
+    const __m128i needle = _mm_set1_epi8(c);
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i)
     {
-        std::stringstream ss;
-        ss << "Extra column \"" << get_column_name() << "\" in header of file "
-           << "\"" << get_file_name() << "\"";
-
-        error = ss.str();
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16*i));
+        unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        mask |= static_cast<std::uint64_t>(bits) << (16*i);
     }
-};
+    return mask;
+}
 
-class missing_column_in_header : public error
+__attribute__((target("avx2")))
+inline std::uint64_t match_mask64_avx2(const char *p, char c)
 {
-public:
-    void format_error_message() override
-    {
-        std::stringstream ss;
-        ss <<  "Missing column \"" << get_column_name() << "\" in header of file "
-           << "\"" << get_file_name() << "\"";
+    const __m256i needle = _mm256_set1_epi8(c);
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    unsigned lo_bits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+    unsigned hi_bits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+    return static_cast<std::uint64_t>(lo_bits) | (static_cast<std::uint64_t>(hi_bits) << 32);
+}
 
-        error = ss.str();
-    }
-};
+__attribute__((target("avx512f,avx512bw")))
+inline std::uint64_t match_mask64_avx512(const char *p, char c)
+{
+    __m512i chunk = _mm512_loadu_si512(p);
+    return _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(c));
+}
 
-class duplicated_column_in_header : public error
+inline match_mask64_fn select_match_mask64()
 {
-public:
-    void format_error_message() override
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
     {
-        std::stringstream ss;
-        ss << "Duplicated column \"" << get_column_name() << "\" in header of file "
-           << "\"" << get_file_name() << "\"";
-
-        error = ss.str();
+        return match_mask64_avx512;
     }
-};
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return match_mask64_avx2;
+    }
+    return match_mask64_sse2;
+}
 
-class header_missing : public error
+inline std::uint64_t match_mask64(const char *p, char c)
 {
-public:
-    void format_error_message() override
-    {
-        std::stringstream ss;
-        ss << "Header missing in file \"" << get_file_name() << "\"";
+    static const match_mask64_fn fn = select_match_mask64();
+    return fn(p, c);
+}
 
-        error = ss.str();
-    }
+/*
+ * Positions of the separator, the quote and the line terminators, null
+ * characters and newlines, in a 64 byte block.
+ */
+struct block_masks
+{
+    std::uint64_t sep;
+    std::uint64_t quote;
+    std::uint64_t end;
 };
 
-class too_few_columns : public error
+using classify_block64_fn = block_masks(*)(const char *p, char sep, char quote);
+
+/*
+ * The classifiers are only called on 64 byte aligned blocks. These never
+ * cross a page boundary, so reading behind the terminator is safe even
+ * though the bytes there do not belong to the string.
+ */
+__attribute__((no_sanitize_address))
+inline block_masks classify_block64_sse2(const char *p, char sep, char quote)
 {
-public:
-    void format_error_message() override
+    const __m128i sep_needle = _mm_set1_epi8(sep);
+    const __m128i quote_needle = _mm_set1_epi8(quote);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i newline = _mm_set1_epi8('\n');
+    block_masks masks = {0, 0, 0};
+    for (int i = 0; i < 4; ++i)
     {
-        std::stringstream ss;
-        ss <<  "Too few columns in line " << get_file_line() << " in file "
-           << "\"" << get_file_name() << "\"";
-
-        error = ss.str();
+        __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(p + 16*i));
+        int shift = 16*i;
+        masks.sep |= static_cast<std::uint64_t>(static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, sep_needle)))) << shift;
+        masks.quote |= static_cast<std::uint64_t>(static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote_needle)))) << shift;
+        masks.end |= static_cast<std::uint64_t>(static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(chunk, zero), _mm_cmpeq_epi8(chunk, newline))))) << shift;
     }
-};
+    return masks;
+}
 
-class too_many_columns : public error
+__attribute__((target("avx2"), no_sanitize_address))
+inline block_masks classify_block64_avx2(const char *p, char sep, char quote)
 {
-public:
-    void format_error_message() override
+    const __m256i sep_needle = _mm256_set1_epi8(sep);
+    const __m256i quote_needle = _mm256_set1_epi8(quote);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i newline = _mm256_set1_epi8('\n');
+    block_masks masks = {0, 0, 0};
+    for (int i = 0; i < 2; ++i)
     {
-        std::stringstream ss;
-        ss << "Too many columns in line " << get_file_line() << " in file "
-           << "\"" << get_file_name() << "\"";
-
-        error = ss.str();
+        __m256i chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(p + 32*i));
+        int shift = 32*i;
+        masks.sep |= static_cast<std::uint64_t>(static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, sep_needle)))) << shift;
+        masks.quote |= static_cast<std::uint64_t>(static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote_needle)))) << shift;
+        masks.end |= static_cast<std::uint64_t>(static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(chunk, zero), _mm256_cmpeq_epi8(chunk, newline))))) << shift;
     }
-};
+    return masks;
+}
 
-class escaped_string_not_closed : public error
+__attribute__((target("avx512f,avx512bw"), no_sanitize_address))
+inline block_masks classify_block64_avx512(const char *p, char sep, char quote)
 {
-public:
-    void format_error_message() override
-    {
-        std::stringstream ss;
-        ss << "Escaped string was not closed in line " << get_file_line()
-           << " in file " << get_file_name();
+    __m512i chunk = _mm512_load_si512(p);
+    block_masks masks;
+    masks.sep = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(sep));
+    masks.quote = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(quote));
+    masks.end = _mm512_cmpeq_epi8_mask(chunk, _mm512_setzero_si512()) |
+        _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\n'));
+    return masks;
+}
 
-        error = ss.str();
+inline classify_block64_fn select_classify_block64()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+    {
+        return classify_block64_avx512;
     }
-};
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return classify_block64_avx2;
+    }
+    return classify_block64_sse2;
+}
 
-class integer_must_be_positive : public error
+inline block_masks classify_block64(const char *p, char sep, char quote)
 {
-public:
-    void format_error_message() override
-    {
-        std::stringstream ss;
-        ss << "The integer " << get_column_content() << " must be positive or 0 "
-           << "in column " << get_column_name() << " in file " << get_file_name()
-           << " in line " << get_file_line();
+    static const classify_block64_fn fn = select_classify_block64();
+    return fn(p, sep, quote);
+}
 
-        error = ss.str();
-    }
-};
+/*
+ * Bit i of the result is the xor of the bits 0 to i of x. Applied to a
+ * quote mask this marks every position from an opening quote up to, but
+ * excluding, the closing quote.
+ */
+using prefix_xor_fn = std::uint64_t(*)(std::uint64_t x);
 
-class no_digit : public error
+inline std::uint64_t prefix_xor_portable(std::uint64_t x)
 {
-public:
-    void format_error_message() override
-    {
-        std::stringstream ss;
-        ss << "The integer " << get_column_content() << " contains an invalid "
-           << "digit in column " << get_column_name() << " in file "
-           << get_file_name() << " in line " << get_file_line();
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
 
-        error = ss.str();
-    }
-};
+#ifdef __x86_64__
+/*
+ * A carry-less multiplication with an all ones operand is a prefix xor.
+ */
+__attribute__((target("pclmul")))
+inline std::uint64_t prefix_xor_clmul(std::uint64_t x)
+{
+    __m128i product = _mm_clmulepi64_si128(
+        _mm_set_epi64x(0, static_cast<long long>(x)), _mm_set1_epi8(-1), 0);
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(product));
+}
+#endif
 
-class integer_overflow : public error
+inline prefix_xor_fn select_prefix_xor()
 {
-public:
-    void format_error_message() override
+#ifdef __x86_64__
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul"))
     {
-        std::stringstream ss;
-        ss << "The integer " << get_column_content() << " overflows in column "
-           << get_column_name() << " in file " << get_file_name()
-           <<" in line " << get_file_line();
-
-        error = ss.str();
+        return prefix_xor_clmul;
     }
-};
+#endif
+    return prefix_xor_portable;
+}
 
-class integer_underflow : public error
+inline std::uint64_t prefix_xor(std::uint64_t x)
+{
+    static const prefix_xor_fn fn = select_prefix_xor();
+    return fn(x);
+}
+
+#endif
+
+/*
+ * Finds line ends 64 bytes at a time and remembers the newlines of the last
+ * scanned window, so that consecutive short lines are located without
+ * touching the data again. The cached positions refer to addresses, so the
+ * index must be reset whenever the data underneath is moved.
+ */
+class LineEndIndex
 {
 public:
-    void format_error_message() override
+    void reset()
     {
-        std::stringstream ss;
-        ss << "The integer " << get_column_content() << " underflows in column "
-           << get_column_name() << " in file " << get_file_line()
-           << " in line " << get_file_line();
+        window = nullptr;
+        mask = 0;
+    }
 
-        error = ss.str();
+    /*
+     * Returns the first '\n' in [begin, end) or end if there is none.
+     */
+    char *find(char *begin, char *end)
+    {
+#ifdef CSV_IO_X86_SIMD
+        if (window != nullptr && begin >= window && begin < window + 64)
+        {
+            std::uint64_t m = mask & (~std::uint64_t(0) << (begin - window));
+            if (m != 0)
+            {
+                return window + __builtin_ctzll(m);
+            }
+            begin = window + 64;
+        }
+
+        while (end - begin >= 64)
+        {
+            std::uint64_t m = match_mask64(begin, '\n');
+            if (m != 0)
+            {
+                window = begin;
+                mask = m;
+                return begin + __builtin_ctzll(m);
+            }
+            begin += 64;
+        }
+
+        window = nullptr;
+#endif
+
+        void *line_end = std::memchr(begin, '\n', end - begin);
+        return line_end != nullptr ? static_cast<char*>(line_end) : end;
     }
+
+private:
+    char *window = nullptr;
+    std::uint64_t mask = 0;
 };
 
-class invalid_single_character : public error
+/*
+ * Finds the column ends for double_quote_escape. Every 64 byte block is
+ * classified once and the separators and line ends in it that are not
+ * enclosed in quotes are kept as a bit mask, through which the following
+ * columns step with ctz. Quotes are only tracked by parity, so escaped
+ * quotes ("") need no special treatment.
+ *
+ * Newlines count as line ends, so a block that also holds the next lines
+ * stays valid for them and is classified before their terminators are
+ * written; loading a block right after storing into it would stall. A
+ * column that starts inside quotes according to the cached parity, f.e.
+ * behind a line with an unclosed quote, classifies its block anew. Bytes
+ * up to a returned column end may be modified, those behind it must stay
+ * as they are until the index is reset, except for the '\r' in front of
+ * a newline, which find accounts for.
+ */
+class ColumnEndIndex
 {
 public:
-    void format_error_message() override
+    void reset()
     {
-        std::stringstream ss;
-        ss << "The content " << get_column_content() << " of column "
-           << get_column_name() << " in file " << get_file_name()
-           << " in line " << get_file_line() << " is not a single character.)";
-
-        error = ss.str();
+        block = nullptr;
     }
-};
 
-} // end namespace error
+#ifdef CSV_IO_X86_SIMD
+    /*
+     * Returns the first separator or line end that is not enclosed in
+     * quotes, starting at col_begin outside of any quotes. Returns null if
+     * the line ends inside quotes.
+     */
+    const char *find(const char *col_begin, char sep, char quote)
+    {
+        std::uint64_t m;
+        if (starts_unquoted(col_begin))
+        {
+            m = (ends | quoted_ends) & (~std::uint64_t(0) << (col_begin - block));
+        }
+        else
+        {
+            m = classify_first(col_begin, sep, quote);
+        }
+        if (m == 0)
+        {
+            m = classify_following(sep, quote);
+        }
 
-////////////////////////////////////////////////////////////////////////////
-//                       Quotes and Separators                            //
-////////////////////////////////////////////////////////////////////////////
+        if ((m & (std::uint64_t(0) - m) & quoted_ends) != 0)
+        {
+            return nullptr;
+        }
+        const char *col_end = block + __builtin_ctzll(m);
 
-using ignore_column = unsigned int;
-static constexpr ignore_column ignore_no_column = 0;
-static constexpr ignore_column ignore_extra_column = 1;
-static constexpr ignore_column ignore_missing_column = 2;
+        /*
+         * The '\r' of a "\r\n" is only replaced by a terminator once the
+         * line is split, which may be after its block was classified. A
+         * column cannot contain a terminator, so one directly in front of
+         * the line end is that '\r' and ends the column instead.
+         */
+        if (*col_end == '\0' && col_end != col_begin && *(col_end-1) == '\0')
+        {
+            --col_end;
+        }
+        return col_end;
+    }
 
-template<char ... trim_char_list>
-class trim_chars
-{
 private:
-    constexpr static bool is_trim_char(char)
+    bool starts_unquoted(const char *col_begin) const
     {
-        return false;
+        return block != nullptr && col_begin >= block && col_begin < block + 64 &&
+            (quoted_before >> (col_begin - block) & 1) == 0;
     }
 
-    template<class ...OtherTrimChars>
-    constexpr static bool is_trim_char(
-        char c,
-        char trim_char,
-        OtherTrimChars... other_trim_chars)
+    /*
+     * The block search is kept out of line so that find, which mostly
+     * only steps through the cached mask, can be inlined.
+     */
+    __attribute__((noinline))
+    std::uint64_t classify_first(const char *col_begin, char sep, char quote)
     {
-        return c == trim_char || is_trim_char(c, other_trim_chars...);
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(col_begin);
+        block = reinterpret_cast<const char*>(address & ~std::uintptr_t(63));
+        classify(~std::uint64_t(0) << (address & 63), 0, sep, quote);
+        return ends | quoted_ends;
     }
 
-public:
-    static void trim(
-        char *&str_begin,
-        char *&str_end)
+    __attribute__((noinline))
+    std::uint64_t classify_following(char sep, char quote)
     {
-        while(str_begin != str_end && is_trim_char(*str_begin, trim_char_list...))
-        {
-            ++str_begin;
-        }
-
-        while(str_begin != str_end && is_trim_char(*(str_end-1), trim_char_list...))
+        for (;;)
         {
-            --str_end;
+            block += 64;
+            classify(~std::uint64_t(0), carry, sep, quote);
+            if ((ends | quoted_ends) != 0)
+            {
+                return ends | quoted_ends;
+            }
         }
+    }
 
-        *str_end = '\0';
+    void classify(std::uint64_t valid, std::uint64_t carry_in, char sep, char quote)
+    {
+        block_masks masks = classify_block64(block, sep, quote);
+        std::uint64_t in_quotes = prefix_xor(masks.quote & valid) ^ carry_in;
+        ends = (masks.sep | masks.end) & valid & ~in_quotes;
+        quoted_ends = masks.end & valid & in_quotes;
+        quoted_before = in_quotes << 1 | (carry_in & 1);
+        carry = std::uint64_t(0) - (in_quotes >> 63);
     }
+
+    /* Bit i is set if byte i of the block follows an unclosed quote */
+    std::uint64_t quoted_before = 0;
+    std::uint64_t ends = 0;
+    std::uint64_t quoted_ends = 0;
+    std::uint64_t carry = 0;
+#else
+private:
+#endif
+    const char *block = nullptr;
 };
 
-class no_comment
+/*
+ * A heap block whose start is aligned to the 64 byte scan windows. The
+ * aligned loads of the scanners can then never reach from the data that
+ * is being parsed into the block that is being read.
+ */
+class AlignedBuffer
 {
 public:
-    static bool is_comment(const char *c)
+    static constexpr std::size_t alignment = 64;
+
+    void reset(std::size_t size)
     {
-        (void)c;
-        return false;
+        storage = std::unique_ptr<char[]>(new char[size + alignment - 1]);
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage.get());
+        std::size_t padding = (alignment - address % alignment) % alignment;
+        data = storage.get() + padding;
     }
+
+    char *get() const                  { return data; }
+    char &operator[](std::size_t i) const { return data[i]; }
+
+private:
+    std::unique_ptr<char[]> storage;
+    char *data = nullptr;
 };
 
-template<char ... comment_start_char_list>
-class single_line_comment
+/*
+ * On Linux the size bytes of the buffer are mapped twice in a row, so that
+ * the size bytes behind any offset are contiguous. Moving the start of the
+ * view with rotate then takes the place of moving the data. If size is not
+ * a multiple of the page size or the mapping fails, an AlignedBuffer is
+ * used instead and is_mirrored returns false.
+ */
+class RingBuffer
 {
-private:
-    constexpr static bool is_comment_start_char(char c)
+public:
+    RingBuffer() = default;
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer&operator=(const RingBuffer&) = delete;
+
+    RingBuffer&operator=(RingBuffer &&other)
     {
-        (void)c;
-        return false;
+        std::swap(fallback, other.fallback);
+        std::swap(mirror, other.mirror);
+        std::swap(size, other.size);
+        std::swap(offset, other.offset);
+        std::swap(data, other.data);
+        return *this;
     }
 
-    template<class ...OtherCommentStartChars>
-    constexpr static bool is_comment_start_char(
-        char c,
-        char comment_start_char,
-        OtherCommentStartChars... other_comment_start_chars)
+    ~RingBuffer()
     {
-        return c == comment_start_char ||
-                    is_comment_start_char(c, other_comment_start_chars...);
+        unmap();
     }
 
-public:
-    static bool is_comment(const char *line)
+    void reset(std::size_t size_)
     {
-        return is_comment_start_char(*line, comment_start_char_list...);
+        unmap();
+        if (!map(size_))
+        {
+            fallback.reset(size_);
+            data = fallback.get();
+        }
     }
-};
 
-class empty_line_comment
-{
-public:
-    static bool is_comment(const char *line)
+    bool is_mirrored() const
     {
-        if (*line == '\0')
+        return mirror != nullptr;
+    }
+
+    void rotate(std::size_t n)
+    {
+        offset = (offset + n) % size;
+        data = mirror + offset;
+    }
+
+    char *get() const                  { return data; }
+    char &operator[](std::size_t i) const { return data[i]; }
+
+private:
+    bool map(std::size_t size_)
+    {
+#if defined(CSV_IO_MIRROR) && defined(SYS_memfd_create)
+        long page_size = sysconf(_SC_PAGESIZE);
+        if (page_size <= 0 || size_ == 0 || size_ % static_cast<std::size_t>(page_size) != 0)
         {
-            return true;
+            return false;
         }
-        while(*line == ' ' || *line == '\t')
+
+#ifdef MFD_CLOEXEC
+        int fd = static_cast<int>(syscall(SYS_memfd_create, "csv_io", MFD_CLOEXEC));
+#else
+        int fd = static_cast<int>(syscall(SYS_memfd_create, "csv_io", 0));
+#endif
+        if (fd == -1)
         {
-            ++line;
-            if(*line == 0)
-            {
-                return true;
-            }
+            return false;
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(size_)) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        /*
+         * Reserve the address range first, then replace both halves with
+         * the same pages.
+         */
+        void *area = mmap(nullptr, 2*size_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (area == MAP_FAILED)
+        {
+            ::close(fd);
+            return false;
         }
+
+        char *begin = static_cast<char*>(area);
+        bool mapped =
+            mmap(begin, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+            mmap(begin + size_, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+        ::close(fd);
+
+        if (!mapped)
+        {
+            munmap(area, 2*size_);
+            return false;
+        }
+
+        mirror = begin;
+        size = size_;
+        offset = 0;
+        data = begin;
+        return true;
+#else
+        (void)size_;
         return false;
+#endif
     }
-};
 
-template<char ... comment_start_char_list>
-class single_and_empty_line_comment
-{
-public:
-    static bool is_comment(const char *line)
+    void unmap()
     {
-        return single_line_comment<comment_start_char_list...>::is_comment(line) ||
-               empty_line_comment::is_comment(line);
+#ifdef CSV_IO_MIRROR
+        if (mirror != nullptr)
+        {
+            munmap(mirror, 2*size);
+        }
+#endif
+        mirror = nullptr;
+        data = nullptr;
     }
+
+    AlignedBuffer fallback;
+    char *mirror = nullptr;
+    std::size_t size = 0;
+    std::size_t offset = 0;
+    char *data = nullptr;
 };
 
-template<char sep>
-class no_quote_escape
+class SynchronousReader
 {
 public:
-    static const char *find_next_column_end(
-        const char *col_begin,
-        std::shared_ptr<error::error> &err)
+    void init(std::unique_ptr<ByteSourceBase> arg_byte_source)
     {
-        (void)err;
-        while(*col_begin != sep && *col_begin != '\0')
-        {
-            ++col_begin;
-        }
-
-        return col_begin;
+        byte_source = std::move(arg_byte_source);
     }
 
-    static void unescape(char *&a, char *&b)
+    bool is_valid() const
     {
-        (void)a;
-        (void)b;
+        return byte_source != nullptr;
     }
-};
 
-template<char sep, char quote>
-class double_quote_escape
+    void start_read(
+        char *arg_buffer,
+        int arg_desired_byte_count)
+    {
+        buffer = arg_buffer;
+        desired_byte_count = arg_desired_byte_count;
+    }
+
+    int finish_read()
+    {
+        return byte_source->read(buffer, desired_byte_count);
+    }
+
+private:
+    std::unique_ptr<ByteSourceBase>byte_source;
+    char *buffer;
+    int desired_byte_count;
+};
+
+#ifdef CSV_IO_THREAD
+
+/*
+ * Performs the reads requested by start_read on a dedicated thread, so that
+ * the next block is read while the current one is parsed.
+ */
+class AsynchronousReader
 {
 public:
-    static const char *find_next_column_end(
-        const char *col_begin,
+    AsynchronousReader() = default;
+    AsynchronousReader(const AsynchronousReader&) = delete;
+    AsynchronousReader&operator=(const AsynchronousReader&) = delete;
+
+    void init(std::unique_ptr<ByteSourceBase> arg_byte_source)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        byte_source = std::move(arg_byte_source);
+        desired_byte_count = -1;
+        read_byte_count = -1;
+        termination_requested = false;
+        worker = std::thread(
+            [this]
+            {
+                std::unique_lock<std::mutex> worker_guard(lock);
+                for(;;)
+                {
+                    read_requested_condition.wait(
+                        worker_guard,
+                        [this]
+                        {
+                            return desired_byte_count != -1 || termination_requested;
+                        });
+
+                    if (termination_requested)
+                    {
+                        return;
+                    }
+
+                    read_byte_count = byte_source->read(buffer, desired_byte_count);
+                    desired_byte_count = -1;
+                    read_finished_condition.notify_one();
+                }
+            });
+    }
+
+    bool is_valid() const
+    {
+        return byte_source != nullptr;
+    }
+
+    void start_read(
+        char *arg_buffer,
+        int arg_desired_byte_count)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        buffer = arg_buffer;
+        desired_byte_count = arg_desired_byte_count;
+        read_byte_count = -1;
+        read_requested_condition.notify_one();
+    }
+
+    int finish_read()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        read_finished_condition.wait(
+            guard,
+            [this]
+            {
+                return read_byte_count != -1;
+            });
+
+        return read_byte_count;
+    }
+
+    ~AsynchronousReader()
+    {
+        if (byte_source != nullptr)
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                termination_requested = true;
+            }
+            read_requested_condition.notify_one();
+            worker.join();
+        }
+    }
+
+private:
+    std::unique_ptr<ByteSourceBase> byte_source;
+    std::thread worker;
+    bool termination_requested;
+    char *buffer;
+    int desired_byte_count;
+    int read_byte_count;
+    std::mutex lock;
+    std::condition_variable read_finished_condition;
+    std::condition_variable read_requested_condition;
+};
+
+#endif
+
+} // end namespace detail
+
+/*
+ * Pass an io::byte_range to a LineReader or CSVReader constructor to only
+ * read the lines that start in [begin, end) of the file. This allows
+ * several readers to split a file among themselves.
+ */
+struct byte_range
+{
+    byte_range(long long begin_, long long end_):
+        begin(begin_),
+        end(end_)
+    {}
+
+    long long begin;
+    long long end;
+};
+
+/*
+ * Pass io::memory_map to a LineReader or CSVReader constructor to read the
+ * file through a memory mapping instead of a buffered copy.
+ */
+struct memory_map_t {};
+static constexpr memory_map_t memory_map = memory_map_t();
+
+/*
+ * Pass io::io_uring to a LineReader or CSVReader constructor to read the
+ * file through io_uring. Only has an effect on Linux when CSV_IO_URING is
+ * defined, otherwise the file is read the usual way.
+ */
+struct io_uring_t {};
+static constexpr io_uring_t io_uring = io_uring_t();
+
+////////////////////////////////////////////////////////////////////////////
+//                               LineReader                               //
+////////////////////////////////////////////////////////////////////////////
+
+class LineReader
+{
+public:
+    /*
+     * Lines longer than the default limit are rejected unless the limit is
+     * raised with set_max_line_length. Offsets into the buffer are ints, so
+     * it cannot be raised beyond max_supported_line_length.
+     */
+    static const int default_max_line_length = (1<<28) - 1;
+    static const int max_supported_line_length = (1<<29) - 1;
+
+    /*
+     * Every reader that is not memory mapped holds 3*block_len bytes. Small
+     * blocks suit many concurrently open small files, large blocks make
+     * long sequential scans cheaper. The value passed to the constructor is
+     * rounded up to a multiple of 64.
+     */
+    static const int default_block_len = 1<<20;
+    static const int min_block_len = 64;
+    static const int max_block_len = 1<<29;
+
+private:
+    /*
+     * The buffer holds 3*block_len bytes. block_len starts out at the value
+     * passed to the constructor and is doubled whenever a line does not fit
+     * into it.
+     */
+    int block_len = default_block_len;
+    int max_line_length = default_max_line_length;
+    detail::RingBuffer buffer;
+#ifdef CSV_IO_THREAD
+    detail::AsynchronousReader reader;
+#else
+    detail::SynchronousReader reader;
+#endif
+    int data_begin;
+    int data_end;
+    char file_name[error::max_file_name_length+1];
+    unsigned file_line;
+    detail::LineEndIndex line_end_index;
+    detail::ColumnEndIndex column_end_index;
+
+    /*
+     * File offset of buffer[0] and the offset at which no further lines
+     * are started, for readers limited to a byte range.
+     */
+    long long buffer_offset = 0;
+    long long range_end = (std::numeric_limits<long long>::max)();
+
+#ifdef CSV_IO_MMAP
+    /*
+     * Only set in memory mapped mode. The lines are then returned directly
+     * from the mapping and buffer is only used for a last line that lacks a
+     * newline, as there is no room for its terminator in the mapping.
+     */
+    std::unique_ptr<detail::MemoryMappedFile> mapping;
+    std::size_t mapped_begin;
+    std::size_t mapped_end;
+#endif
+
+private:
+    static std::unique_ptr<ByteSourceBase> open_file(
+        const char *file_name,
         std::shared_ptr<error::error> &err)
     {
-        while(*col_begin != sep && *col_begin != '\0')
+        if (err)
+        {
+            return nullptr;
+        }
+
+        /*
+         * We open the file in binary mode as it makes no difference under *nix
+         * and under Windows we handle \r\n newlines ourself.
+         */
+        FILE *file = std::fopen(file_name, "rb");
+        if(file == 0)
+        {
+            /*
+             * store errno as soon as possible, doing it after constructor
+             * call can fail.
+             */
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(file_name);
+
+            return nullptr;
+        }
+
+        return std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file));
+    }
+
+    /*
+     * Opens the file positioned one byte in front of the range, so that the
+     * line that begin falls into can be recognized and skipped by init_range.
+     */
+    std::unique_ptr<ByteSourceBase> open_file_range(
+        const char *file_name_,
+        byte_range range,
+        std::shared_ptr<error::error> &err)
+    {
+        std::unique_ptr<ByteSourceBase> source = open_file(file_name_, err);
+        if (!source)
+        {
+            return nullptr;
+        }
+
+        FILE *file = static_cast<detail::OwningStdIOByteSourceBase*>(source.get())->get_file();
+        buffer_offset = range.begin > 0 ? range.begin - 1 : 0;
+        if (!detail::seek_file(file, buffer_offset))
+        {
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(file_name_);
+            return nullptr;
+        }
+
+        return source;
+    }
+
+    void init_range(
+        byte_range range,
+        std::shared_ptr<error::error> &err)
+    {
+        if (err)
+        {
+            return;
+        }
+
+        if (range.begin > 0)
+        {
+            /*
+             * Drop the remainder of the line that started in front of the
+             * range. If the byte in front of the range is a newline, this
+             * is an empty remainder.
+             */
+            next_line(err);
+            file_line = 0;
+        }
+        range_end = range.end;
+    }
+
+    static std::unique_ptr<ByteSourceBase> open_io_uring_file(
+        const char *file_name,
+        std::shared_ptr<error::error> &err)
+    {
+#ifdef CSV_IO_URING_ENABLED
+        if (err)
+        {
+            return nullptr;
+        }
+
+        int fd = ::open(file_name, O_RDONLY);
+        if (fd == -1)
+        {
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(file_name);
+            return nullptr;
+        }
+
+        std::unique_ptr<ByteSourceBase> source = detail::OwningIoUringByteSource::open(fd);
+        if (source)
+        {
+            return source;
+        }
+
+        FILE *file = fdopen(fd, "rb");
+        if (file == nullptr)
+        {
+            ::close(fd);
+            return open_file(file_name, err);
+        }
+
+        return std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file));
+#else
+        return open_file(file_name, err);
+#endif
+    }
+
+    bool init(
+        std::unique_ptr<ByteSourceBase> byte_source,
+        int block_len_)
+    {
+        if (!byte_source)
+        {
+            return false;
+        }
+
+        if (block_len_ <= min_block_len)
+        {
+            block_len = min_block_len;
+        }
+        else if (block_len_ >= max_block_len)
+        {
+            block_len = max_block_len;
+        }
+        else
+        {
+            block_len = (block_len_ + 63)/64*64;
+        }
+
+        file_line = 0;
+        buffer.reset(3*block_len);
+        data_begin = 0;
+        data_end = byte_source->read(buffer.get(), 2*block_len);
+
+        /* Ignore UTF-8 BOM */
+        if(data_end >= 3 && buffer[0] == '\xEF' && buffer[1] == '\xBB' && buffer[2] == '\xBF')
+        {
+            data_begin = 3;
+        }
+
+        if(data_end == 2*block_len)
+        {
+            reader.init(std::move(byte_source));
+            reader.start_read(buffer.get() + 2*block_len, block_len);
+        }
+
+        return true;
+    }
+
+    void init_memory_mapped(
+        const char *file_name_,
+        std::shared_ptr<error::error> &err)
+    {
+#ifdef CSV_IO_MMAP
+        if (err)
+        {
+            return;
+        }
+
+        int fd = ::open(file_name_, O_RDONLY);
+        if (fd == -1)
+        {
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(file_name_);
+            return;
+        }
+
+        mapping = detail::MemoryMappedFile::map(fd);
+        if (!mapping)
+        {
+            /*
+             * Pipes, devices and files that do not fit into the address
+             * space are read the usual way.
+             */
+            FILE *file = fdopen(fd, "rb");
+            if (file == nullptr)
+            {
+                ::close(fd);
+                init(open_file(file_name_, err), default_block_len);
+                return;
+            }
+
+            init(
+                std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file)),
+                default_block_len);
+            return;
+        }
+
+        ::close(fd);
+
+        file_line = 0;
+        mapped_begin = 0;
+        mapped_end = mapping->get_size();
+
+        const char *data = mapping->get_data();
+        if(mapped_end >= 3 && data[0] == '\xEF' && data[1] == '\xBB' && data[2] == '\xBF')
+        {
+            mapped_begin = 3;
+        }
+#else
+        init(open_file(file_name_, err), default_block_len);
+#endif
+    }
+
+    /*
+     * Doubles block_len, keeping the unconsumed bytes and the pending read.
+     * Afterwards the unconsumed bytes start at buffer[0] and the buffer is
+     * refilled up to 2*block_len, as after init.
+     */
+    template<class Err>
+    bool grow_buffer(Err &err)
+    {
+        int new_block_len = block_len;
+        if (block_len <= max_line_length)
+        {
+            int required = max_line_length/64*64 + 64;
+            new_block_len = block_len > required/2 ? required : 2*block_len;
+        }
+        if (new_block_len == block_len)
+        {
+            detail::raise_line_length_limit_exceeded(err, max_line_length, file_name, file_line);
+            return false;
+        }
+
+        int pending = 0;
+        if (reader.is_valid())
+        {
+            pending = reader.finish_read();
+        }
+
+        detail::RingBuffer grown;
+        grown.reset(3*new_block_len);
+        std::memcpy(grown.get(), buffer.get() + data_begin, data_end - data_begin);
+        std::memcpy(grown.get() + data_end - data_begin, buffer.get() + 2*block_len, pending);
+
+        buffer = std::move(grown);
+        buffer_offset += data_begin;
+        data_end = data_end - data_begin + pending;
+        data_begin = 0;
+        block_len = new_block_len;
+        line_end_index.reset();
+        column_end_index.reset();
+
+        if (reader.is_valid())
+        {
+            while (data_end < 2*block_len)
+            {
+                reader.start_read(buffer.get() + data_end, 2*block_len - data_end);
+                int n = reader.finish_read();
+                if (n == 0)
+                {
+                    break;
+                }
+                data_end += n;
+            }
+            reader.start_read(buffer.get() + 2*block_len, block_len);
+        }
+
+        return true;
+    }
+
+#ifdef CSV_IO_MMAP
+    char *next_memory_mapped_line()
+    {
+        if (mapped_begin == mapped_end)
+        {
+            return nullptr;
+        }
+
+        ++file_line;
+
+        char *line_begin = mapping->get_data() + mapped_begin;
+        std::size_t remaining = mapped_end - mapped_begin;
+        char *line_end = line_end_index.find(line_begin, line_begin + remaining);
+
+        if (line_end != line_begin + remaining)
+        {
+            mapped_begin += line_end - line_begin + 1;
+        }
+        else
+        {
+            /*
+             * The last line is missing its newline and the mapping has no
+             * byte left for the terminator, so this line gets copied.
+             */
+            buffer.reset(remaining+1);
+            std::memcpy(buffer.get(), line_begin, remaining);
+            line_begin = buffer.get();
+            line_end = line_begin + remaining;
+            mapped_begin = mapped_end;
+            column_end_index.reset();
+        }
+
+        *line_end = '\0';
+
+        /*
+         * handle windows \r\n-line breaks
+         */
+        if(line_end != line_begin && *(line_end-1) == '\r')
+        {
+            *(line_end-1) = '\0';
+        }
+
+        return line_begin;
+    }
+#endif
+
+public:
+    LineReader() = delete;
+    LineReader(const LineReader&) = delete;
+    LineReader&operator=(const LineReader&) = delete;
+
+    explicit LineReader(
+        std::shared_ptr<error::error> &err,
+        const char *file_name_,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        init(open_file(file_name, err), block_len_);
+    }
+
+    explicit LineReader(
+        std::shared_ptr<error::error> &err,
+        const std::string &file_name_,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        init(open_file(file_name_.c_str(), err), block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const char *file_name_,
+        std::unique_ptr<ByteSourceBase> byte_source,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        init(std::move(byte_source), block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const std::string &file_name_,
+        std::unique_ptr<ByteSourceBase> byte_source,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        init(std::move(byte_source), block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const char *file_name_,
+        const char *data_begin_,
+        const char *data_end_,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        init(std::unique_ptr<ByteSourceBase>(
+            new detail::NonOwningStringByteSource(data_begin_, data_end_-data_begin_)),
+            block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const std::string &file_name_,
+        const char *data_begin_,
+        const char *data_end_,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        init(std::unique_ptr<ByteSourceBase>(
+            new detail::NonOwningStringByteSource(data_begin_, data_end_-data_begin_)),
+            block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const char *file_name_,
+        FILE *file,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        init(std::unique_ptr<ByteSourceBase>(
+            new detail::OwningStdIOByteSourceBase(file)),
+            block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const std::string &file_name_,
+        FILE *file,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        init(std::unique_ptr<ByteSourceBase>(
+            new detail::OwningStdIOByteSourceBase(file)),
+            block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const char *file_name_,
+        std::istream &in,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        init(std::unique_ptr<ByteSourceBase>(
+            new detail::NonOwningIStreamByteSource(in)),
+            block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &,
+        const std::string &file_name_,
+        std::istream &in,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        init(std::unique_ptr<ByteSourceBase>(
+            new detail::NonOwningIStreamByteSource(in)),
+            block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &err,
+        const char *file_name_,
+        memory_map_t)
+    {
+        set_file_name(file_name_);
+        init_memory_mapped(file_name, err);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &err,
+        const std::string &file_name_,
+        memory_map_t)
+    {
+        set_file_name(file_name_.c_str());
+        init_memory_mapped(file_name_.c_str(), err);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &err,
+        const char *file_name_,
+        byte_range range,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        if (init(open_file_range(file_name, range, err), block_len_))
+        {
+            init_range(range, err);
+        }
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &err,
+        const std::string &file_name_,
+        byte_range range,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        if (init(open_file_range(file_name_.c_str(), range, err), block_len_))
+        {
+            init_range(range, err);
+        }
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &err,
+        const char *file_name_,
+        io_uring_t,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_);
+        init(open_io_uring_file(file_name, err), block_len_);
+    }
+
+    LineReader(
+        std::shared_ptr<error::error> &err,
+        const std::string &file_name_,
+        io_uring_t,
+        int block_len_ = default_block_len)
+    {
+        set_file_name(file_name_.c_str());
+        init(open_io_uring_file(file_name_.c_str(), err), block_len_);
+    }
+
+    void set_file_name(const char *file_name_)
+    {
+        if(file_name_ != nullptr)
+        {
+            strncpy(file_name, file_name_, sizeof(file_name));
+            file_name[sizeof(file_name)-1] = '\0';
+        }
+        else
+        {
+            file_name[0] = '\0';
+        }
+    }
+
+    void set_file_name(const std::string &file_name_)
+    {
+        set_file_name(file_name_.c_str());
+    }
+
+    const char *get_truncated_file_name() const
+    {
+        return file_name;
+    }
+
+    void set_file_line(unsigned file_line_)
+    {
+        file_line = file_line_;
+    }
+
+    unsigned get_file_line() const
+    {
+        return file_line;
+    }
+
+    /*
+     * Limits the length of a line in characters, excluding the newline.
+     * Longer lines make next_line fail with line_length_limit_exceeded.
+     * Memory mapped readers are not limited as they do not copy lines.
+     */
+    void set_max_line_length(int max_line_length_)
+    {
+        int limit = max_supported_line_length;
+        max_line_length = (std::max)(0, (std::min)(max_line_length_, limit));
+    }
+
+    int get_max_line_length() const
+    {
+        return max_line_length;
+    }
+
+    /*
+     * The current block length, which is larger than the one passed to the
+     * constructor if a long line made the buffer grow.
+     */
+    int get_block_len() const
+    {
+        return block_len;
+    }
+
+    /*
+     * The file offset of the first byte that has not been returned by
+     * next_line yet.
+     */
+    long long get_byte_offset() const
+    {
+#ifdef CSV_IO_MMAP
+        if (mapping)
+        {
+            return static_cast<long long>(mapped_begin);
+        }
+#endif
+        return buffer_offset + data_begin;
+    }
+
+    /*
+     * Used by the readers that split the lines returned by next_line into
+     * columns. It is reset whenever the lines in the buffer move.
+     */
+    detail::ColumnEndIndex &get_column_end_index()
+    {
+        return column_end_index;
+    }
+
+    template<class Err>
+    char *next_line(Err &err)
+    {
+        if (err)
+        {
+            return nullptr;
+        }
+
+#ifdef CSV_IO_MMAP
+        if (mapping)
+        {
+            return next_memory_mapped_line();
+        }
+#endif
+
+        if(data_begin == data_end || buffer_offset + data_begin >= range_end)
+        {
+            return nullptr;
+        }
+
+        ++file_line;
+
+        if (data_begin >= data_end)
+        {
+            detail::raise_internal_error(err, "Internal error: data_begin >= data_end");
+            return nullptr;
+        }
+        if (data_end > block_len*2)
+        {
+            detail::raise_internal_error(err, "Internal error: data_end > block_len*2\n");
+            return nullptr;
+        }
+
+        if (data_begin >= block_len)
+        {
+            line_end_index.reset();
+            column_end_index.reset();
+            buffer_offset += block_len;
+            data_begin -= block_len;
+            data_end -= block_len;
+            if (buffer.is_mirrored())
+            {
+                /*
+                 * The consumed first block becomes the third one, which
+                 * leaves the other two blocks where the data already is.
+                 */
+                buffer.rotate(block_len);
+                if(reader.is_valid())
+                {
+                    data_end += reader.finish_read();
+                    reader.start_read(buffer.get() + 2*block_len, block_len);
+                }
+            }
+            else
+            {
+                std::memcpy(buffer.get(), buffer.get()+block_len, block_len);
+                if(reader.is_valid())
+                {
+                    data_end += reader.finish_read();
+                    std::memcpy(buffer.get()+block_len, buffer.get()+2*block_len, block_len);
+                    reader.start_read(buffer.get() + 2*block_len, block_len);
+                }
+            }
+        }
+
+        int line_end = line_end_index.find(
+            buffer.get() + data_begin, buffer.get() + data_end) - buffer.get();
+
+        while(line_end - data_begin + 1 > block_len)
+        {
+            int scanned = line_end - data_begin;
+            if (!grow_buffer(err))
+            {
+                return nullptr;
+            }
+            line_end = line_end_index.find(
+                buffer.get() + scanned, buffer.get() + data_end) - buffer.get();
+        }
+
+        if(line_end - data_begin > max_line_length)
+        {
+            detail::raise_line_length_limit_exceeded(err, max_line_length, file_name, file_line);
+            return nullptr;
+        }
+
+        if(line_end != data_end && buffer[line_end] == '\n')
+        {
+            buffer[line_end] = '\0';
+        }
+        else
+        {
+            /*
+             * Some files are missing the newline at the end of the
+             * last line
+             */
+            ++data_end;
+            buffer[line_end] = '\0';
+            column_end_index.reset();
+        }
+
+        /*
+         * handle windows \r\n-line breaks
+         */
+        if(line_end != data_begin && buffer[line_end-1] == '\r')
+        {
+            buffer[line_end-1] = '\0';
+        }
+
+        char *ret = buffer.get() + data_begin;
+        data_begin = line_end+1;
+
+        return ret;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////
+//                           CsvReader Errors                             //
+////////////////////////////////////////////////////////////////////////////
+
+namespace error
+{
+
+constexpr int max_column_name_length = 63;
+constexpr int max_column_content_length = 63;
+
+class extra_column_in_header : public error
+{
+public:
+    static constexpr code error_code = code::extra_column_in_header;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Extra column \"" << get_column_name() << "\" in header of file "
+           << "\"" << get_file_name() << "\"";
+
+        error = ss.str();
+    }
+};
+
+class missing_column_in_header : public error
+{
+public:
+    static constexpr code error_code = code::missing_column_in_header;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss <<  "Missing column \"" << get_column_name() << "\" in header of file "
+           << "\"" << get_file_name() << "\"";
+
+        error = ss.str();
+    }
+};
+
+class duplicated_column_in_header : public error
+{
+public:
+    static constexpr code error_code = code::duplicated_column_in_header;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Duplicated column \"" << get_column_name() << "\" in header of file "
+           << "\"" << get_file_name() << "\"";
+
+        error = ss.str();
+    }
+};
+
+class header_missing : public error
+{
+public:
+    static constexpr code error_code = code::header_missing;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Header missing in file \"" << get_file_name() << "\"";
+
+        error = ss.str();
+    }
+};
+
+class too_few_columns : public error
+{
+public:
+    static constexpr code error_code = code::too_few_columns;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss <<  "Too few columns in line " << get_file_line() << " in file "
+           << "\"" << get_file_name() << "\"";
+
+        error = ss.str();
+    }
+};
+
+class too_many_columns : public error
+{
+public:
+    static constexpr code error_code = code::too_many_columns;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Too many columns in line " << get_file_line() << " in file "
+           << "\"" << get_file_name() << "\"";
+
+        error = ss.str();
+    }
+};
+
+class escaped_string_not_closed : public error
+{
+public:
+    static constexpr code error_code = code::escaped_string_not_closed;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "Escaped string was not closed in line " << get_file_line()
+           << " in file " << get_file_name();
+
+        error = ss.str();
+    }
+};
+
+class integer_must_be_positive : public error
+{
+public:
+    static constexpr code error_code = code::integer_must_be_positive;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "The integer " << get_column_content() << " must be positive or 0 "
+           << "in column " << get_column_name() << " in file " << get_file_name()
+           << " in line " << get_file_line();
+
+        error = ss.str();
+    }
+};
+
+class no_digit : public error
+{
+public:
+    static constexpr code error_code = code::no_digit;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "The integer " << get_column_content() << " contains an invalid "
+           << "digit in column " << get_column_name() << " in file "
+           << get_file_name() << " in line " << get_file_line();
+
+        error = ss.str();
+    }
+};
+
+class integer_overflow : public error
+{
+public:
+    static constexpr code error_code = code::integer_overflow;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "The integer " << get_column_content() << " overflows in column "
+           << get_column_name() << " in file " << get_file_name()
+           <<" in line " << get_file_line();
+
+        error = ss.str();
+    }
+};
+
+class integer_underflow : public error
+{
+public:
+    static constexpr code error_code = code::integer_underflow;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "The integer " << get_column_content() << " underflows in column "
+           << get_column_name() << " in file " << get_file_line()
+           << " in line " << get_file_line();
+
+        error = ss.str();
+    }
+};
+
+class invalid_single_character : public error
+{
+public:
+    static constexpr code error_code = code::invalid_single_character;
+    code get_code() const override { return error_code; }
+
+    void format_error_message() override
+    {
+        std::stringstream ss;
+        ss << "The content " << get_column_content() << " of column "
+           << get_column_name() << " in file " << get_file_name()
+           << " in line " << get_file_line() << " is not a single character.)";
+
+        error = ss.str();
+    }
+};
+
+inline std::shared_ptr<error> status::to_error() const
+{
+    std::shared_ptr<error> e;
+    switch (error_code)
+    {
+    case code::none:
+        return e;
+    case code::line_length_limit_exceeded:
+        {
+            std::shared_ptr<line_length_limit_exceeded> l =
+                std::make_shared<line_length_limit_exceeded>();
+            l->set_max_line_length(max_line_length);
+            e = l;
+        }
+        break;
+    case code::internal_error:
+        e = std::make_shared<internal_error>();
+        break;
+    case code::cannot_open_file:
+        e = std::make_shared<cannot_open_file>();
+        break;
+    case code::cannot_write_file:
+        e = std::make_shared<cannot_write_file>();
+        break;
+    case code::temporary_file_error:
+        e = std::make_shared<temporary_file_error>();
+        break;
+    case code::extra_column_in_header:
+        e = std::make_shared<extra_column_in_header>();
+        break;
+    case code::missing_column_in_header:
+        e = std::make_shared<missing_column_in_header>();
+        break;
+    case code::duplicated_column_in_header:
+        e = std::make_shared<duplicated_column_in_header>();
+        break;
+    case code::header_missing:
+        e = std::make_shared<header_missing>();
+        break;
+    case code::too_few_columns:
+        e = std::make_shared<too_few_columns>();
+        break;
+    case code::too_many_columns:
+        e = std::make_shared<too_many_columns>();
+        break;
+    case code::escaped_string_not_closed:
+        e = std::make_shared<escaped_string_not_closed>();
+        break;
+    case code::integer_must_be_positive:
+        e = std::make_shared<integer_must_be_positive>();
+        break;
+    case code::no_digit:
+        e = std::make_shared<no_digit>();
+        break;
+    case code::integer_overflow:
+        e = std::make_shared<integer_overflow>();
+        break;
+    case code::integer_underflow:
+        e = std::make_shared<integer_underflow>();
+        break;
+    case code::invalid_single_character:
+        e = std::make_shared<invalid_single_character>();
+        break;
+    }
+
+    e->set_file_name(file_name);
+    e->set_file_line(file_line);
+    e->set_errno(errno_);
+    e->set_column_name(column_name);
+    e->set_column_content(column_content);
+    e->format_error_message();
+    return e;
+}
+
+} // end namespace error
+
+////////////////////////////////////////////////////////////////////////////
+//                       Quotes and Separators                            //
+////////////////////////////////////////////////////////////////////////////
+
+using ignore_column = unsigned int;
+static constexpr ignore_column ignore_no_column = 0;
+static constexpr ignore_column ignore_extra_column = 1;
+static constexpr ignore_column ignore_missing_column = 2;
+static constexpr ignore_column ignore_trailing_columns = 4;
+
+template<char ... trim_char_list>
+class trim_chars
+{
+private:
+    constexpr static bool is_trim_char(char)
+    {
+        return false;
+    }
+
+    template<class ...OtherTrimChars>
+    constexpr static bool is_trim_char(
+        char c,
+        char trim_char,
+        OtherTrimChars... other_trim_chars)
+    {
+        return c == trim_char || is_trim_char(c, other_trim_chars...);
+    }
+
+public:
+    static void trim(
+        char *&str_begin,
+        char *&str_end)
+    {
+        while(str_begin != str_end && is_trim_char(*str_begin, trim_char_list...))
+        {
+            ++str_begin;
+        }
+
+        while(str_begin != str_end && is_trim_char(*(str_end-1), trim_char_list...))
+        {
+            --str_end;
+        }
+
+        *str_end = '\0';
+    }
+};
+
+class no_comment
+{
+public:
+    static bool is_comment(const char *c)
+    {
+        (void)c;
+        return false;
+    }
+};
+
+template<char ... comment_start_char_list>
+class single_line_comment
+{
+private:
+    constexpr static bool is_comment_start_char(char c)
+    {
+        (void)c;
+        return false;
+    }
+
+    template<class ...OtherCommentStartChars>
+    constexpr static bool is_comment_start_char(
+        char c,
+        char comment_start_char,
+        OtherCommentStartChars... other_comment_start_chars)
+    {
+        return c == comment_start_char ||
+                    is_comment_start_char(c, other_comment_start_chars...);
+    }
+
+public:
+    static bool is_comment(const char *line)
+    {
+        return is_comment_start_char(*line, comment_start_char_list...);
+    }
+};
+
+class empty_line_comment
+{
+public:
+    static bool is_comment(const char *line)
+    {
+        if (*line == '\0')
+        {
+            return true;
+        }
+        while(*line == ' ' || *line == '\t')
+        {
+            ++line;
+            if(*line == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template<char ... comment_start_char_list>
+class single_and_empty_line_comment
+{
+public:
+    static bool is_comment(const char *line)
+    {
+        return single_line_comment<comment_start_char_list...>::is_comment(line) ||
+               empty_line_comment::is_comment(line);
+    }
+};
+
+template<char sep>
+class no_quote_escape
+{
+public:
+    template<class Err>
+    static const char *find_next_column_end(
+        const char *col_begin,
+        Err &err)
+    {
+        (void)err;
+        while(*col_begin != sep && *col_begin != '\0')
+        {
+            ++col_begin;
+        }
+
+        return col_begin;
+    }
+
+    static void unescape(char *&a, char *&b)
+    {
+        (void)a;
+        (void)b;
+    }
+};
+
+template<char sep, char quote>
+class double_quote_escape
+{
+public:
+#ifdef CSV_IO_X86_SIMD
+    /*
+     * Used by the readers, which keep the index for the rest of the line.
+     */
+    template<class Err>
+    static const char *find_next_column_end(
+        const char *col_begin,
+        detail::ColumnEndIndex &index,
+        Err &err)
+    {
+        const char *col_end = index.find(col_begin, sep, quote);
+        if (col_end == nullptr)
+        {
+            detail::raise_error<error::escaped_string_not_closed>(err);
+        }
+        return col_end;
+    }
+#endif
+
+    template<class Err>
+    static const char *find_next_column_end(
+        const char *col_begin,
+        Err &err)
+    {
+#ifdef CSV_IO_X86_SIMD
+        detail::ColumnEndIndex index;
+        return find_next_column_end(col_begin, index, err);
+#else
+        while(*col_begin != sep && *col_begin != '\0')
+        {
+            if(*col_begin != quote)
+            {
+                ++col_begin;
+            }
+            else
+            {
+                do {
+                    ++col_begin;
+                    while(*col_begin != quote)
+                    {
+                        if(*col_begin == '\0')
+                        {
+                            detail::raise_error<error::escaped_string_not_closed>(err);
+                            return nullptr;
+                        }
+                        ++col_begin;
+                    }
+                    ++col_begin;
+                } while(*col_begin == quote);
+            }
+        }
+        return col_begin;
+#endif
+    }
+
+    static void unescape(
+        char *&col_begin,
+        char *&col_end)
+    {
+        if(col_end - col_begin >= 2)
+        {
+            if(*col_begin == quote && *(col_end-1) == quote)
+            {
+                ++col_begin;
+                --col_end;
+                char *out = col_begin;
+                for(char*in = col_begin; in!=col_end; ++in)
+                {
+                    if(*in == quote && (in+1) != col_end && *(in+1) == quote)
+                    {
+                        ++in;
+                    }
+                    *out = *in;
+                    ++out;
+                }
+                col_end = out;
+                *col_end = '\0';
+            }
+        }
+    }
+};
+
+class ignore_overflow
+{
+public:
+    template<class T>
+    static void on_overflow(T&){}
+
+    template<class T>
+    static void on_underflow(T&){}
+};
+
+class set_to_max_on_overflow
+{
+public:
+    template<class T>
+    static void on_overflow(T &x)
+    {
+        /*
+         * Using (std::numeric_limits<T>::max) instead of std::numeric_limits<T>::max
+         * to make code including windows.h with its max macro happy
+         */
+        x = (std::numeric_limits<T>::max)();
+    }
+
+    template<class T>
+    static void on_underflow(T &x)
+    {
+        x = (std::numeric_limits<T>::min)();
+    }
+};
+
+/*
+ * Error policies decide what CSVReader does with a malformed row. With
+ * stop_on_error the row is reported through err and reading stops. With
+ * skip_bad_rows the row is dropped, counted by its error::code and the
+ * first max_recorded_lines line numbers are kept. Errors that do not
+ * concern a single row, such as an overlong line, are always reported.
+ *
+ * no_error_check is meant for trusted input. The rows are still split and
+ * their column count is checked, but read_row and read_rows convert
+ * integers without validating the digits or checking for overflow. Other
+ * types are converted as usual, except that a field that cannot be
+ * converted leaves the variable unspecified instead of raising an error.
+ */
+class stop_on_error
+{
+public:
+    static constexpr bool checks_fields = true;
+    static constexpr bool skips_bad_rows = false;
+    static constexpr std::size_t max_recorded_lines = 0;
+};
+
+template<std::size_t max_lines = 0>
+class skip_bad_rows
+{
+public:
+    static constexpr bool checks_fields = true;
+    static constexpr bool skips_bad_rows = true;
+    static constexpr std::size_t max_recorded_lines = max_lines;
+};
+
+class no_error_check
+{
+public:
+    static constexpr bool checks_fields = false;
+    static constexpr bool skips_bad_rows = false;
+    static constexpr std::size_t max_recorded_lines = 0;
+};
+
+namespace detail
+{
+
+/*
+ * The functions below that split and convert a single row expect err to
+ * be clear and do not check it again. The functions of CSVReader and
+ * ParallelCSVReader check it once per row and stop at the first error.
+ */
+
+/*
+ * A quote policy may take a ColumnEndIndex, which is shared by the columns
+ * of a line. User defined policies only need the two argument version.
+ */
+template<class quote_policy, class Err>
+auto find_column_end(const char *col_begin, ColumnEndIndex &index, Err &err, int)
+    -> decltype(quote_policy::find_next_column_end(col_begin, index, err))
+{
+    return quote_policy::find_next_column_end(col_begin, index, err);
+}
+
+template<class quote_policy, class Err>
+const char *find_column_end(const char *col_begin, ColumnEndIndex &, Err &err, long)
+{
+    return quote_policy::find_next_column_end(col_begin, err);
+}
+
+/*
+ * line must not be null; parse_line checks this before every column. index
+ * must be reset before the first column of a line.
+ */
+template<class quote_policy, class Err>
+bool chop_next_column(
+    char *&line,
+    char *&col_begin,
+    char *&col_end,
+    ColumnEndIndex &index,
+    Err &err)
+{
+    col_begin = line;
+
+    /* The col_begin + (... - col_begin) removes the constness */
+    col_end = col_begin + (find_column_end<quote_policy>(col_begin, index, err, 0) - col_begin);
+
+    if (err)
+    {
+        return false;
+    }
+
+    if(*col_end == '\0')
+    {
+        line = nullptr;
+    }
+    else
+    {
+        *col_end = '\0';
+        line = col_end + 1;
+    }
+
+    return true;
+}
+
+/*
+ * If ignore_trailing is set, col_order ends with the last requested column
+ * and the rest of the line is neither split nor counted. index may carry
+ * over from the previous line of the same buffer.
+ */
+template<class trim_policy, class quote_policy, class Err>
+bool parse_line(
+   char *line,
+   char **sorted_col,
+   const std::vector<int> &col_order,
+   ColumnEndIndex &index,
+   Err &err,
+   bool ignore_trailing = false)
+{
+    for (int i : col_order)
+    {
+        if(line == nullptr)
+        {
+            raise_error<error::too_few_columns>(err);
+            return false;
+        }
+
+        char *col_begin;
+        char *col_end;
+
+        if (!chop_next_column<quote_policy>(line, col_begin, col_end, index, err))
+        {
+            return false;
+        }
+
+        if (i != -1)
+        {
+            trim_policy::trim(col_begin, col_end);
+            quote_policy::unescape(col_begin, col_end);
+            sorted_col[i] = col_begin;
+        }
+    }
+
+    if(line != nullptr && !ignore_trailing)
+    {
+        raise_error<error::too_many_columns>(err);
+        return false;
+    }
+
+    return true;
+}
+
+template<class trim_policy, class quote_policy, class Err>
+bool parse_line(
+   char *line,
+   char **sorted_col,
+   const std::vector<int> &col_order,
+   Err &err,
+   bool ignore_trailing = false)
+{
+    ColumnEndIndex index;
+    return parse_line<trim_policy, quote_policy>(line, sorted_col, col_order, index, err, ignore_trailing);
+}
+
+inline std::uint64_t mix_hash(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline std::uint64_t hash_bytes(const char *p, std::size_t len)
+{
+    std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    while (len >= 8)
+    {
+        std::uint64_t x;
+        std::memcpy(&x, p, 8);
+        h = mix_hash(h ^ x);
+        p += 8;
+        len -= 8;
+    }
+    std::uint64_t x = 0;
+    std::memcpy(&x, p, len);
+    return mix_hash(h ^ x);
+}
+
+/*
+ * Maps the requested column names to their position with an open
+ * addressing hash table and records which of them are read from the file.
+ * Matching a header thereby costs one lookup per column of the file, and
+ * has_column takes constant time. If a name is requested twice, the first
+ * position is found.
+ */
+class column_name_index
+{
+public:
+    void assign(const std::string *names_, unsigned count)
+    {
+        names.assign(names_, names_ + count);
+        read.assign(count, false);
+
+        std::size_t len = 8;
+        while (len < 2*static_cast<std::size_t>(count))
+        {
+            len *= 2;
+        }
+        slots.assign(len, -1);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            std::size_t s = find_slot(names[i].data(), names[i].size());
+            if (slots[s] == -1)
+            {
+                slots[s] = static_cast<int>(i);
+            }
+        }
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(names.size());
+    }
+
+    /*
+     * Returns the position of the name or -1.
+     */
+    int find(const char *name, std::size_t len) const
+    {
+        if (slots.empty())
+        {
+            return -1;
+        }
+        return slots[find_slot(name, len)];
+    }
+
+    int find(const std::string &name) const
+    {
+        return find(name.data(), name.size());
+    }
+
+    const std::string &get_name(unsigned i) const
+    {
+        return names[i];
+    }
+
+    bool is_read(unsigned i) const
+    {
+        return read[i];
+    }
+
+    void set_read(unsigned i)
+    {
+        read[i] = true;
+    }
+
+    void clear_read()
+    {
+        std::fill(read.begin(), read.end(), false);
+    }
+
+    void set_all_read()
+    {
+        std::fill(read.begin(), read.end(), true);
+    }
+
+    bool has_column(const std::string &name) const
+    {
+        int i = find(name);
+        return i != -1 && read[i];
+    }
+
+private:
+    /*
+     * Returns the slot that holds the name or the empty slot at which
+     * probing for it stops.
+     */
+    std::size_t find_slot(const char *name, std::size_t len) const
+    {
+        std::size_t mask = slots.size() - 1;
+        std::size_t s = static_cast<std::size_t>(hash_bytes(name, len)) & mask;
+        while (slots[s] != -1)
+        {
+            const std::string &n = names[slots[s]];
+            if (n.size() == len && std::memcmp(n.data(), name, len) == 0)
+            {
+                break;
+            }
+            s = (s + 1) & mask;
+        }
+        return s;
+    }
+
+    std::vector<std::string> names;
+    std::vector<bool> read;
+    std::vector<int> slots;
+};
+
+template<class trim_policy, class quote_policy>
+bool parse_header_line(
+    char *line,
+    std::vector<int> &col_order,
+    column_name_index &columns,
+    ignore_column ignore_policy,
+    std::shared_ptr<error::error> &err)
+{
+    if (err)
+    {
+        return false;
+    }
+
+    col_order.clear();
+    columns.clear_read();
+
+    ColumnEndIndex index;
+    while(line)
+    {
+        char *col_begin;
+        char *col_end;
+        if (!chop_next_column<quote_policy>(line, col_begin, col_end, index, err))
+        {
+            return false;
+        }
+
+        trim_policy::trim(col_begin, col_end);
+        quote_policy::unescape(col_begin, col_end);
+
+        int i = columns.find(col_begin, std::strlen(col_begin));
+        if(i != -1)
+        {
+            if(columns.is_read(i))
+            {
+                err = std::make_shared<error::duplicated_column_in_header>();
+                err->set_column_name(col_begin);
+                return false;
+            }
+
+            columns.set_read(i);
+            col_order.push_back(i);
+        }
+        else
+        {
+            if(ignore_policy & ::io::ignore_extra_column)
+            {
+                col_order.push_back(-1);
+            }
+            else
+            {
+                err = std::make_shared<error::extra_column_in_header>();
+                err->set_column_name(col_begin);
+                return false;
+            }
+        }
+    }
+    if(!(ignore_policy & ::io::ignore_missing_column))
+    {
+        for(unsigned i = 0; i < columns.size(); ++i)
+        {
+            if(!columns.is_read(i))
+            {
+                err = std::make_shared<error::missing_column_in_header>();
+                err->set_column_name(columns.get_name(i).c_str());
+                return false;
+            }
+        }
+    }
+
+    if(ignore_policy & ::io::ignore_trailing_columns)
+    {
+        while(!col_order.empty() && col_order.back() == -1)
+        {
+            col_order.pop_back();
+        }
+    }
+
+    return true;
+}
+
+template<class overflow_policy, class Err>
+bool parse(
+    char *col,
+    char &x,
+    Err &err)
+{
+    if(!*col)
+    {
+        raise_error<error::invalid_single_character>(err);
+        return false;
+    }
+
+    x = *col;
+    ++col;
+
+    if(*col)
+    {
+        raise_error<error::invalid_single_character>(err);
+        return false;
+    }
+
+    return true;
+}
+
+template<class overflow_policy, class Err>
+bool parse(
+    char *col,
+    std::string &x,
+    Err &err)
+{
+    (void)err;
+    x = col;
+    return true;
+}
+
+template<class overflow_policy, class Err>
+bool parse(
+    char *col,
+    const char *&x,
+    Err &err)
+{
+    (void)err;
+    x = col;
+    return true;
+}
+
+template<class overflow_policy, class Err>
+bool parse(
+    char *col,
+    char *&x,
+    Err &err)
+{
+    (void)err;
+    x = col;
+    return true;
+}
+
+/*
+ * Converts 8 ASCII digits, stored little endian in x, at once. Each
+ * multiplication adds every lane to its shifted neighbour, which merges
+ * the digits into four 2-digit, then two 4-digit and finally one 8-digit
+ * number.
+ */
+inline std::uint32_t parse_eight_digits(std::uint64_t x)
+{
+    x = ((x & 0x0F0F0F0F0F0F0F0Fu) * 2561) >> 8;
+    x = ((x & 0x00FF00FF00FF00FFu) * 6553601) >> 16;
+    return static_cast<std::uint32_t>(((x & 0x0000FFFF0000FFFFu) * 42949672960001u) >> 32);
+}
+
+inline bool is_eight_digits(std::uint64_t x)
+{
+    return (((x + 0x4646464646464646u) | (x - 0x3030303030303030u)) & 0x8080808080808080u) == 0;
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CSV_IO_SWAR_DIGITS
+
+typedef std::uint64_t __attribute__((__may_alias__, __aligned__(1))) unaligned_uint64;
+
+/*
+ * Loads 8 bytes if they lie in the same 64 byte window as p. As the
+ * terminator is in that window too, the load can neither leave the page
+ * nor reach into the block that is being read by another thread.
+ */
+__attribute__((no_sanitize_address))
+inline bool load_eight_bytes(const char *p, std::uint64_t &x)
+{
+    if ((reinterpret_cast<std::uintptr_t>(p) & 63) > 56)
+    {
+        return false;
+    }
+    x = *reinterpret_cast<const unaligned_uint64*>(p);
+    return true;
+}
+#endif
+
+/*
+ * Returns the number of digits at the start of col and stores the value of
+ * the first 19 of them, which always fits into 64 bits, in x.
+ */
+inline int scan_digits(const char *col, std::uint64_t &x)
+{
+    const char *p = col;
+    x = 0;
+
+#ifdef CSV_IO_SWAR_DIGITS
+    std::uint64_t chunk;
+    while(p - col <= 8 && load_eight_bytes(p, chunk) && is_eight_digits(chunk))
+    {
+        x = 100000000*x + parse_eight_digits(chunk);
+        p += 8;
+    }
+#endif
+
+    while('0' <= *p && *p <= '9' && p - col < 19)
+    {
+        x = 10*x + (*p - '0');
+        ++p;
+    }
+    while('0' <= *p && *p <= '9')
+    {
+        ++p;
+    }
+    return static_cast<int>(p - col);
+}
+
+/*
+ * Splits the value of the n digits at col into all but the last digit and
+ * the last digit, for n <= 20 and x as returned by scan_digits.
+ */
+inline void split_last_digit(const char *col, int n, std::uint64_t &x, int &last)
+{
+    if (n <= 19)
+    {
+        last = static_cast<int>(x % 10);
+        x /= 10;
+    }
+    else
+    {
+        last = col[19] - '0';
+    }
+}
+
+/*
+ * Numbers with up to digits10 digits always fit into T, so only numbers
+ * with one more digit need an overflow check, which is done once on the
+ * last digit. Numbers that are even longer or contain other characters
+ * are handled digit by digit.
+ */
+template<class overflow_policy, class T, class Err>
+bool parse_unsigned_integer(
+    const char *col,
+    T &x,
+    Err &err)
+{
+    if(*col == '-')
+    {
+        raise_error<error::integer_must_be_positive>(err);
+        return false;
+    }
+
+    const int max_digits = std::numeric_limits<T>::digits10;
+    std::uint64_t value;
+    int n = scan_digits(col, value);
+    if(col[n] == '\0' && n <= max_digits)
+    {
+        x = static_cast<T>(value);
+        return true;
+    }
+    if(col[n] == '\0' && n == max_digits + 1)
+    {
+        int last;
+        split_last_digit(col, n, value, last);
+        x = static_cast<T>(value);
+        T y = static_cast<T>(last);
+        if(x > ((std::numeric_limits<T>::max)()-y)/10)
+        {
+            overflow_policy::on_overflow(x);
+            return true;
+        }
+        x = 10*x+y;
+        return true;
+    }
+
+    x = 0;
+    while(*col != '\0')
+    {
+        if('0' <= *col && *col <= '9')
+        {
+            T y = *col - '0';
+            if(x > ((std::numeric_limits<T>::max)()-y)/10)
+            {
+                overflow_policy::on_overflow(x);
+                return true;
+            }
+            x = 10*x+y;
+        }
+        else
+        {
+            raise_error<error::no_digit>(err);
+            return false;
+        }
+        ++col;
+    }
+
+    return true;
+}
+
+template<class overflow_policy, class Err> bool parse(char *col, unsigned char &x, Err &err)
+    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, unsigned short &x, Err &err)
+    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, unsigned int &x, Err &err)
+    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, unsigned long &x, Err &err)
+    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, unsigned long long &x, Err &err)
+    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
+
+template<class overflow_policy, class T, class Err>
+bool parse_signed_integer(
+    const char *col,
+    T &x,
+    Err &err)
+{
+    if(*col == '-')
+    {
+        ++col;
+
+        const int max_digits = std::numeric_limits<T>::digits10;
+        std::uint64_t value;
+        int n = scan_digits(col, value);
+        if(col[n] == '\0' && n <= max_digits)
+        {
+            x = static_cast<T>(-static_cast<T>(value));
+            return true;
+        }
+        if(col[n] == '\0' && n == max_digits + 1)
+        {
+            int last;
+            split_last_digit(col, n, value, last);
+            x = static_cast<T>(-static_cast<T>(value));
+            T y = static_cast<T>(last);
+            if(x < ((std::numeric_limits<T>::min)()+y)/10)
+            {
+                overflow_policy::on_underflow(x);
+                return true;
+            }
+            x = 10*x-y;
+            return true;
+        }
+
+        x = 0;
+        while(*col != '\0')
+        {
+            if('0' <= *col && *col <= '9')
+            {
+                T y = *col - '0';
+                if(x < ((std::numeric_limits<T>::min)()+y)/10)
+                {
+                    overflow_policy::on_underflow(x);
+                    return true;
+                }
+                x = 10*x-y;
+            }
+            else
+            {
+                raise_error<error::no_digit>(err);
+                return false;
+            }
+            ++col;
+        }
+        return true;
+    }
+    else if(*col == '+')
+    {
+        ++col;
+    }
+
+    return parse_unsigned_integer<overflow_policy>(col, x, err);
+}
+
+template<class overflow_policy, class Err> bool parse(char *col, signed char &x, Err &err)
+    {return parse_signed_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, signed short &x, Err &err)
+    {return parse_signed_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, signed int &x, Err &err)
+    {return parse_signed_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, signed long &x, Err &err)
+    {return parse_signed_integer<overflow_policy>(col, x, err);}
+template<class overflow_policy, class Err> bool parse(char *col, signed long long &x, Err &err)
+    {return parse_signed_integer<overflow_policy>(col, x, err);}
+
+/*
+ * Correctly rounded decimal to binary conversion. The parser collects up to
+ * 19 significant digits into an integer w, so that the column is w*10^q.
+ * This is converted with Clinger's fast path if w and 10^q are both exact
+ * in T, and with the Eisel-Lemire algorithm otherwise. Only if more than 19
+ * digits were present and the dropped digits affect the rounding, the text
+ * is passed to strtod.
+ */
+
+struct uint128
+{
+    std::uint64_t low;
+    std::uint64_t high;
+};
+
+inline uint128 full_multiplication(std::uint64_t a, std::uint64_t b)
+{
+    uint128 r;
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 native_uint128;
+    native_uint128 p = static_cast<native_uint128>(a)*b;
+    r.low = static_cast<std::uint64_t>(p);
+    r.high = static_cast<std::uint64_t>(p >> 64);
+#else
+    std::uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    std::uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    std::uint64_t lo_lo = a_lo*b_lo;
+    std::uint64_t hi_lo = a_hi*b_lo;
+    std::uint64_t lo_hi = a_lo*b_hi;
+    std::uint64_t hi_hi = a_hi*b_hi;
+    std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    r.low = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+    r.high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+    return r;
+}
+
+inline int leading_zeroes(std::uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while ((x & (std::uint64_t(1) << 63)) == 0)
+    {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static constexpr int smallest_power_of_five = -342;
+static constexpr int largest_power_of_five = 308;
+
+/*
+ * 5^q for q in [-342, 308] as 128 bit numbers, shifted so that the most
+ * significant bit is set. Negative powers are rounded up.
+ */
+inline const std::uint64_t *power_of_five_128()
+{
+    static const std::uint64_t table[] = {
+        0xeef453d6923bd65au, 0x113faa2906a13b3fu,
+        0x9558b4661b6565f8u, 0x4ac7ca59a424c507u,
+        0xbaaee17fa23ebf76u, 0x5d79bcf00d2df649u,
+        0xe95a99df8ace6f53u, 0xf4d82c2c107973dcu,
+        0x91d8a02bb6c10594u, 0x79071b9b8a4be869u,
+        0xb64ec836a47146f9u, 0x9748e2826cdee284u,
+        0xe3e27a444d8d98b7u, 0xfd1b1b2308169b25u,
+        0x8e6d8c6ab0787f72u, 0xfe30f0f5e50e20f7u,
+        0xb208ef855c969f4fu, 0xbdbd2d335e51a935u,
+        0xde8b2b66b3bc4723u, 0xad2c788035e61382u,
+        0x8b16fb203055ac76u, 0x4c3bcb5021afcc31u,
+        0xaddcb9e83c6b1793u, 0xdf4abe242a1bbf3du,
+        0xd953e8624b85dd78u, 0xd71d6dad34a2af0du,
+        0x87d4713d6f33aa6bu, 0x8672648c40e5ad68u,
+        0xa9c98d8ccb009506u, 0x680efdaf511f18c2u,
+        0xd43bf0effdc0ba48u, 0x0212bd1b2566def2u,
+        0x84a57695fe98746du, 0x014bb630f7604b57u,
+        0xa5ced43b7e3e9188u, 0x419ea3bd35385e2du,
+        0xcf42894a5dce35eau, 0x52064cac828675b9u,
+        0x818995ce7aa0e1b2u, 0x7343efebd1940993u,
+        0xa1ebfb4219491a1fu, 0x1014ebe6c5f90bf8u,
+        0xca66fa129f9b60a6u, 0xd41a26e077774ef6u,
+        0xfd00b897478238d0u, 0x8920b098955522b4u,
+        0x9e20735e8cb16382u, 0x55b46e5f5d5535b0u,
+        0xc5a890362fddbc62u, 0xeb2189f734aa831du,
+        0xf712b443bbd52b7bu, 0xa5e9ec7501d523e4u,
+        0x9a6bb0aa55653b2du, 0x47b233c92125366eu,
+        0xc1069cd4eabe89f8u, 0x999ec0bb696e840au,
+        0xf148440a256e2c76u, 0xc00670ea43ca250du,
+        0x96cd2a865764dbcau, 0x380406926a5e5728u,
+        0xbc807527ed3e12bcu, 0xc605083704f5ecf2u,
+        0xeba09271e88d976bu, 0xf7864a44c633682eu,
+        0x93445b8731587ea3u, 0x7ab3ee6afbe0211du,
+        0xb8157268fdae9e4cu, 0x5960ea05bad82964u,
+        0xe61acf033d1a45dfu, 0x6fb92487298e33bdu,
+        0x8fd0c16206306babu, 0xa5d3b6d479f8e056u,
+        0xb3c4f1ba87bc8696u, 0x8f48a4899877186cu,
+        0xe0b62e2929aba83cu, 0x331acdabfe94de87u,
+        0x8c71dcd9ba0b4925u, 0x9ff0c08b7f1d0b14u,
+        0xaf8e5410288e1b6fu, 0x07ecf0ae5ee44dd9u,
+        0xdb71e91432b1a24au, 0xc9e82cd9f69d6150u,
+        0x892731ac9faf056eu, 0xbe311c083a225cd2u,
+        0xab70fe17c79ac6cau, 0x6dbd630a48aaf406u,
+        0xd64d3d9db981787du, 0x092cbbccdad5b108u,
+        0x85f0468293f0eb4eu, 0x25bbf56008c58ea5u,
+        0xa76c582338ed2621u, 0xaf2af2b80af6f24eu,
+        0xd1476e2c07286faau, 0x1af5af660db4aee1u,
+        0x82cca4db847945cau, 0x50d98d9fc890ed4du,
+        0xa37fce126597973cu, 0xe50ff107bab528a0u,
+        0xcc5fc196fefd7d0cu, 0x1e53ed49a96272c8u,
+        0xff77b1fcbebcdc4fu, 0x25e8e89c13bb0f7au,
+        0x9faacf3df73609b1u, 0x77b191618c54e9acu,
+        0xc795830d75038c1du, 0xd59df5b9ef6a2417u,
+        0xf97ae3d0d2446f25u, 0x4b0573286b44ad1du,
+        0x9becce62836ac577u, 0x4ee367f9430aec32u,
+        0xc2e801fb244576d5u, 0x229c41f793cda73fu,
+        0xf3a20279ed56d48au, 0x6b43527578c1110fu,
+        0x9845418c345644d6u, 0x830a13896b78aaa9u,
+        0xbe5691ef416bd60cu, 0x23cc986bc656d553u,
+        0xedec366b11c6cb8fu, 0x2cbfbe86b7ec8aa8u,
+        0x94b3a202eb1c3f39u, 0x7bf7d71432f3d6a9u,
+        0xb9e08a83a5e34f07u, 0xdaf5ccd93fb0cc53u,
+        0xe858ad248f5c22c9u, 0xd1b3400f8f9cff68u,
+        0x91376c36d99995beu, 0x23100809b9c21fa1u,
+        0xb58547448ffffb2du, 0xabd40a0c2832a78au,
+        0xe2e69915b3fff9f9u, 0x16c90c8f323f516cu,
+        0x8dd01fad907ffc3bu, 0xae3da7d97f6792e3u,
+        0xb1442798f49ffb4au, 0x99cd11cfdf41779cu,
+        0xdd95317f31c7fa1du, 0x40405643d711d583u,
+        0x8a7d3eef7f1cfc52u, 0x482835ea666b2572u,
+        0xad1c8eab5ee43b66u, 0xda3243650005eecfu,
+        0xd863b256369d4a40u, 0x90bed43e40076a82u,
+        0x873e4f75e2224e68u, 0x5a7744a6e804a291u,
+        0xa90de3535aaae202u, 0x711515d0a205cb36u,
+        0xd3515c2831559a83u, 0x0d5a5b44ca873e03u,
+        0x8412d9991ed58091u, 0xe858790afe9486c2u,
+        0xa5178fff668ae0b6u, 0x626e974dbe39a872u,
+        0xce5d73ff402d98e3u, 0xfb0a3d212dc8128fu,
+        0x80fa687f881c7f8eu, 0x7ce66634bc9d0b99u,
+        0xa139029f6a239f72u, 0x1c1fffc1ebc44e80u,
+        0xc987434744ac874eu, 0xa327ffb266b56220u,
+        0xfbe9141915d7a922u, 0x4bf1ff9f0062baa8u,
+        0x9d71ac8fada6c9b5u, 0x6f773fc3603db4a9u,
+        0xc4ce17b399107c22u, 0xcb550fb4384d21d3u,
+        0xf6019da07f549b2bu, 0x7e2a53a146606a48u,
+        0x99c102844f94e0fbu, 0x2eda7444cbfc426du,
+        0xc0314325637a1939u, 0xfa911155fefb5308u,
+        0xf03d93eebc589f88u, 0x793555ab7eba27cau,
+        0x96267c7535b763b5u, 0x4bc1558b2f3458deu,
+        0xbbb01b9283253ca2u, 0x9eb1aaedfb016f16u,
+        0xea9c227723ee8bcbu, 0x465e15a979c1cadcu,
+        0x92a1958a7675175fu, 0x0bfacd89ec191ec9u,
+        0xb749faed14125d36u, 0xcef980ec671f667bu,
+        0xe51c79a85916f484u, 0x82b7e12780e7401au,
+        0x8f31cc0937ae58d2u, 0xd1b2ecb8b0908810u,
+        0xb2fe3f0b8599ef07u, 0x861fa7e6dcb4aa15u,
+        0xdfbdcece67006ac9u, 0x67a791e093e1d49au,
+        0x8bd6a141006042bdu, 0xe0c8bb2c5c6d24e0u,
+        0xaecc49914078536du, 0x58fae9f773886e18u,
+        0xda7f5bf590966848u, 0xaf39a475506a899eu,
+        0x888f99797a5e012du, 0x6d8406c952429603u,
+        0xaab37fd7d8f58178u, 0xc8e5087ba6d33b83u,
+        0xd5605fcdcf32e1d6u, 0xfb1e4a9a90880a64u,
+        0x855c3be0a17fcd26u, 0x5cf2eea09a55067fu,
+        0xa6b34ad8c9dfc06fu, 0xf42faa48c0ea481eu,
+        0xd0601d8efc57b08bu, 0xf13b94daf124da26u,
+        0x823c12795db6ce57u, 0x76c53d08d6b70858u,
+        0xa2cb1717b52481edu, 0x54768c4b0c64ca6eu,
+        0xcb7ddcdda26da268u, 0xa9942f5dcf7dfd09u,
+        0xfe5d54150b090b02u, 0xd3f93b35435d7c4cu,
+        0x9efa548d26e5a6e1u, 0xc47bc5014a1a6dafu,
+        0xc6b8e9b0709f109au, 0x359ab6419ca1091bu,
+        0xf867241c8cc6d4c0u, 0xc30163d203c94b62u,
+        0x9b407691d7fc44f8u, 0x79e0de63425dcf1du,
+        0xc21094364dfb5636u, 0x985915fc12f542e4u,
+        0xf294b943e17a2bc4u, 0x3e6f5b7b17b2939du,
+        0x979cf3ca6cec5b5au, 0xa705992ceecf9c42u,
+        0xbd8430bd08277231u, 0x50c6ff782a838353u,
+        0xece53cec4a314ebdu, 0xa4f8bf5635246428u,
+        0x940f4613ae5ed136u, 0x871b7795e136be99u,
+        0xb913179899f68584u, 0x28e2557b59846e3fu,
+        0xe757dd7ec07426e5u, 0x331aeada2fe589cfu,
+        0x9096ea6f3848984fu, 0x3ff0d2c85def7621u,
+        0xb4bca50b065abe63u, 0x0fed077a756b53a9u,
+        0xe1ebce4dc7f16dfbu, 0xd3e8495912c62894u,
+        0x8d3360f09cf6e4bdu, 0x64712dd7abbbd95cu,
+        0xb080392cc4349decu, 0xbd8d794d96aacfb3u,
+        0xdca04777f541c567u, 0xecf0d7a0fc5583a0u,
+        0x89e42caaf9491b60u, 0xf41686c49db57244u,
+        0xac5d37d5b79b6239u, 0x311c2875c522ced5u,
+        0xd77485cb25823ac7u, 0x7d633293366b828bu,
+        0x86a8d39ef77164bcu, 0xae5dff9c02033197u,
+        0xa8530886b54dbdebu, 0xd9f57f830283fdfcu,
+        0xd267caa862a12d66u, 0xd072df63c324fd7bu,
+        0x8380dea93da4bc60u, 0x4247cb9e59f71e6du,
+        0xa46116538d0deb78u, 0x52d9be85f074e608u,
+        0xcd795be870516656u, 0x67902e276c921f8bu,
+        0x806bd9714632dff6u, 0x00ba1cd8a3db53b6u,
+        0xa086cfcd97bf97f3u, 0x80e8a40eccd228a4u,
+        0xc8a883c0fdaf7df0u, 0x6122cd128006b2cdu,
+        0xfad2a4b13d1b5d6cu, 0x796b805720085f81u,
+        0x9cc3a6eec6311a63u, 0xcbe3303674053bb0u,
+        0xc3f490aa77bd60fcu, 0xbedbfc4411068a9cu,
+        0xf4f1b4d515acb93bu, 0xee92fb5515482d44u,
+        0x991711052d8bf3c5u, 0x751bdd152d4d1c4au,
+        0xbf5cd54678eef0b6u, 0xd262d45a78a0635du,
+        0xef340a98172aace4u, 0x86fb897116c87c34u,
+        0x9580869f0e7aac0eu, 0xd45d35e6ae3d4da0u,
+        0xbae0a846d2195712u, 0x8974836059cca109u,
+        0xe998d258869facd7u, 0x2bd1a438703fc94bu,
+        0x91ff83775423cc06u, 0x7b6306a34627ddcfu,
+        0xb67f6455292cbf08u, 0x1a3bc84c17b1d542u,
+        0xe41f3d6a7377eecau, 0x20caba5f1d9e4a93u,
+        0x8e938662882af53eu, 0x547eb47b7282ee9cu,
+        0xb23867fb2a35b28du, 0xe99e619a4f23aa43u,
+        0xdec681f9f4c31f31u, 0x6405fa00e2ec94d4u,
+        0x8b3c113c38f9f37eu, 0xde83bc408dd3dd04u,
+        0xae0b158b4738705eu, 0x9624ab50b148d445u,
+        0xd98ddaee19068c76u, 0x3badd624dd9b0957u,
+        0x87f8a8d4cfa417c9u, 0xe54ca5d70a80e5d6u,
+        0xa9f6d30a038d1dbcu, 0x5e9fcf4ccd211f4cu,
+        0xd47487cc8470652bu, 0x7647c3200069671fu,
+        0x84c8d4dfd2c63f3bu, 0x29ecd9f40041e073u,
+        0xa5fb0a17c777cf09u, 0xf468107100525890u,
+        0xcf79cc9db955c2ccu, 0x7182148d4066eeb4u,
+        0x81ac1fe293d599bfu, 0xc6f14cd848405530u,
+        0xa21727db38cb002fu, 0xb8ada00e5a506a7cu,
+        0xca9cf1d206fdc03bu, 0xa6d90811f0e4851cu,
+        0xfd442e4688bd304au, 0x908f4a166d1da663u,
+        0x9e4a9cec15763e2eu, 0x9a598e4e043287feu,
+        0xc5dd44271ad3cdbau, 0x40eff1e1853f29fdu,
+        0xf7549530e188c128u, 0xd12bee59e68ef47cu,
+        0x9a94dd3e8cf578b9u, 0x82bb74f8301958ceu,
+        0xc13a148e3032d6e7u, 0xe36a52363c1faf01u,
+        0xf18899b1bc3f8ca1u, 0xdc44e6c3cb279ac1u,
+        0x96f5600f15a7b7e5u, 0x29ab103a5ef8c0b9u,
+        0xbcb2b812db11a5deu, 0x7415d448f6b6f0e7u,
+        0xebdf661791d60f56u, 0x111b495b3464ad21u,
+        0x936b9fcebb25c995u, 0xcab10dd900beec34u,
+        0xb84687c269ef3bfbu, 0x3d5d514f40eea742u,
+        0xe65829b3046b0afau, 0x0cb4a5a3112a5112u,
+        0x8ff71a0fe2c2e6dcu, 0x47f0e785eaba72abu,
+        0xb3f4e093db73a093u, 0x59ed216765690f56u,
+        0xe0f218b8d25088b8u, 0x306869c13ec3532cu,
+        0x8c974f7383725573u, 0x1e414218c73a13fbu,
+        0xafbd2350644eeacfu, 0xe5d1929ef90898fau,
+        0xdbac6c247d62a583u, 0xdf45f746b74abf39u,
+        0x894bc396ce5da772u, 0x6b8bba8c328eb783u,
+        0xab9eb47c81f5114fu, 0x066ea92f3f326564u,
+        0xd686619ba27255a2u, 0xc80a537b0efefebdu,
+        0x8613fd0145877585u, 0xbd06742ce95f5f36u,
+        0xa798fc4196e952e7u, 0x2c48113823b73704u,
+        0xd17f3b51fca3a7a0u, 0xf75a15862ca504c5u,
+        0x82ef85133de648c4u, 0x9a984d73dbe722fbu,
+        0xa3ab66580d5fdaf5u, 0xc13e60d0d2e0ebbau,
+        0xcc963fee10b7d1b3u, 0x318df905079926a8u,
+        0xffbbcfe994e5c61fu, 0xfdf17746497f7052u,
+        0x9fd561f1fd0f9bd3u, 0xfeb6ea8bedefa633u,
+        0xc7caba6e7c5382c8u, 0xfe64a52ee96b8fc0u,
+        0xf9bd690a1b68637bu, 0x3dfdce7aa3c673b0u,
+        0x9c1661a651213e2du, 0x06bea10ca65c084eu,
+        0xc31bfa0fe5698db8u, 0x486e494fcff30a62u,
+        0xf3e2f893dec3f126u, 0x5a89dba3c3efccfau,
+        0x986ddb5c6b3a76b7u, 0xf89629465a75e01cu,
+        0xbe89523386091465u, 0xf6bbb397f1135823u,
+        0xee2ba6c0678b597fu, 0x746aa07ded582e2cu,
+        0x94db483840b717efu, 0xa8c2a44eb4571cdcu,
+        0xba121a4650e4ddebu, 0x92f34d62616ce413u,
+        0xe896a0d7e51e1566u, 0x77b020baf9c81d17u,
+        0x915e2486ef32cd60u, 0x0ace1474dc1d122eu,
+        0xb5b5ada8aaff80b8u, 0x0d819992132456bau,
+        0xe3231912d5bf60e6u, 0x10e1fff697ed6c69u,
+        0x8df5efabc5979c8fu, 0xca8d3ffa1ef463c1u,
+        0xb1736b96b6fd83b3u, 0xbd308ff8a6b17cb2u,
+        0xddd0467c64bce4a0u, 0xac7cb3f6d05ddbdeu,
+        0x8aa22c0dbef60ee4u, 0x6bcdf07a423aa96bu,
+        0xad4ab7112eb3929du, 0x86c16c98d2c953c6u,
+        0xd89d64d57a607744u, 0xe871c7bf077ba8b7u,
+        0x87625f056c7c4a8bu, 0x11471cd764ad4972u,
+        0xa93af6c6c79b5d2du, 0xd598e40d3dd89bcfu,
+        0xd389b47879823479u, 0x4aff1d108d4ec2c3u,
+        0x843610cb4bf160cbu, 0xcedf722a585139bau,
+        0xa54394fe1eedb8feu, 0xc2974eb4ee658828u,
+        0xce947a3da6a9273eu, 0x733d226229feea32u,
+        0x811ccc668829b887u, 0x0806357d5a3f525fu,
+        0xa163ff802a3426a8u, 0xca07c2dcb0cf26f7u,
+        0xc9bcff6034c13052u, 0xfc89b393dd02f0b5u,
+        0xfc2c3f3841f17c67u, 0xbbac2078d443ace2u,
+        0x9d9ba7832936edc0u, 0xd54b944b84aa4c0du,
+        0xc5029163f384a931u, 0x0a9e795e65d4df11u,
+        0xf64335bcf065d37du, 0x4d4617b5ff4a16d5u,
+        0x99ea0196163fa42eu, 0x504bced1bf8e4e45u,
+        0xc06481fb9bcf8d39u, 0xe45ec2862f71e1d6u,
+        0xf07da27a82c37088u, 0x5d767327bb4e5a4cu,
+        0x964e858c91ba2655u, 0x3a6a07f8d510f86fu,
+        0xbbe226efb628afeau, 0x890489f70a55368bu,
+        0xeadab0aba3b2dbe5u, 0x2b45ac74ccea842eu,
+        0x92c8ae6b464fc96fu, 0x3b0b8bc90012929du,
+        0xb77ada0617e3bbcbu, 0x09ce6ebb40173744u,
+        0xe55990879ddcaabdu, 0xcc420a6a101d0515u,
+        0x8f57fa54c2a9eab6u, 0x9fa946824a12232du,
+        0xb32df8e9f3546564u, 0x47939822dc96abf9u,
+        0xdff9772470297ebdu, 0x59787e2b93bc56f7u,
+        0x8bfbea76c619ef36u, 0x57eb4edb3c55b65au,
+        0xaefae51477a06b03u, 0xede622920b6b23f1u,
+        0xdab99e59958885c4u, 0xe95fab368e45ecedu,
+        0x88b402f7fd75539bu, 0x11dbcb0218ebb414u,
+        0xaae103b5fcd2a881u, 0xd652bdc29f26a119u,
+        0xd59944a37c0752a2u, 0x4be76d3346f0495fu,
+        0x857fcae62d8493a5u, 0x6f70a4400c562ddbu,
+        0xa6dfbd9fb8e5b88eu, 0xcb4ccd500f6bb952u,
+        0xd097ad07a71f26b2u, 0x7e2000a41346a7a7u,
+        0x825ecc24c873782fu, 0x8ed400668c0c28c8u,
+        0xa2f67f2dfa90563bu, 0x728900802f0f32fau,
+        0xcbb41ef979346bcau, 0x4f2b40a03ad2ffb9u,
+        0xfea126b7d78186bcu, 0xe2f610c84987bfa8u,
+        0x9f24b832e6b0f436u, 0x0dd9ca7d2df4d7c9u,
+        0xc6ede63fa05d3143u, 0x91503d1c79720dbbu,
+        0xf8a95fcf88747d94u, 0x75a44c6397ce912au,
+        0x9b69dbe1b548ce7cu, 0xc986afbe3ee11abau,
+        0xc24452da229b021bu, 0xfbe85badce996168u,
+        0xf2d56790ab41c2a2u, 0xfae27299423fb9c3u,
+        0x97c560ba6b0919a5u, 0xdccd879fc967d41au,
+        0xbdb6b8e905cb600fu, 0x5400e987bbc1c920u,
+        0xed246723473e3813u, 0x290123e9aab23b68u,
+        0x9436c0760c86e30bu, 0xf9a0b6720aaf6521u,
+        0xb94470938fa89bceu, 0xf808e40e8d5b3e69u,
+        0xe7958cb87392c2c2u, 0xb60b1d1230b20e04u,
+        0x90bd77f3483bb9b9u, 0xb1c6f22b5e6f48c2u,
+        0xb4ecd5f01a4aa828u, 0x1e38aeb6360b1af3u,
+        0xe2280b6c20dd5232u, 0x25c6da63c38de1b0u,
+        0x8d590723948a535fu, 0x579c487e5a38ad0eu,
+        0xb0af48ec79ace837u, 0x2d835a9df0c6d851u,
+        0xdcdb1b2798182244u, 0xf8e431456cf88e65u,
+        0x8a08f0f8bf0f156bu, 0x1b8e9ecb641b58ffu,
+        0xac8b2d36eed2dac5u, 0xe272467e3d222f3fu,
+        0xd7adf884aa879177u, 0x5b0ed81dcc6abb0fu,
+        0x86ccbb52ea94baeau, 0x98e947129fc2b4e9u,
+        0xa87fea27a539e9a5u, 0x3f2398d747b36224u,
+        0xd29fe4b18e88640eu, 0x8eec7f0d19a03aadu,
+        0x83a3eeeef9153e89u, 0x1953cf68300424acu,
+        0xa48ceaaab75a8e2bu, 0x5fa8c3423c052dd7u,
+        0xcdb02555653131b6u, 0x3792f412cb06794du,
+        0x808e17555f3ebf11u, 0xe2bbd88bbee40bd0u,
+        0xa0b19d2ab70e6ed6u, 0x5b6aceaeae9d0ec4u,
+        0xc8de047564d20a8bu, 0xf245825a5a445275u,
+        0xfb158592be068d2eu, 0xeed6e2f0f0d56712u,
+        0x9ced737bb6c4183du, 0x55464dd69685606bu,
+        0xc428d05aa4751e4cu, 0xaa97e14c3c26b886u,
+        0xf53304714d9265dfu, 0xd53dd99f4b3066a8u,
+        0x993fe2c6d07b7fabu, 0xe546a8038efe4029u,
+        0xbf8fdb78849a5f96u, 0xde98520472bdd033u,
+        0xef73d256a5c0f77cu, 0x963e66858f6d4440u,
+        0x95a8637627989aadu, 0xdde7001379a44aa8u,
+        0xbb127c53b17ec159u, 0x5560c018580d5d52u,
+        0xe9d71b689dde71afu, 0xaab8f01e6e10b4a6u,
+        0x9226712162ab070du, 0xcab3961304ca70e8u,
+        0xb6b00d69bb55c8d1u, 0x3d607b97c5fd0d22u,
+        0xe45c10c42a2b3b05u, 0x8cb89a7db77c506au,
+        0x8eb98a7a9a5b04e3u, 0x77f3608e92adb242u,
+        0xb267ed1940f1c61cu, 0x55f038b237591ed3u,
+        0xdf01e85f912e37a3u, 0x6b6c46dec52f6688u,
+        0x8b61313bbabce2c6u, 0x2323ac4b3b3da015u,
+        0xae397d8aa96c1b77u, 0xabec975e0a0d081au,
+        0xd9c7dced53c72255u, 0x96e7bd358c904a21u,
+        0x881cea14545c7575u, 0x7e50d64177da2e54u,
+        0xaa242499697392d2u, 0xdde50bd1d5d0b9e9u,
+        0xd4ad2dbfc3d07787u, 0x955e4ec64b44e864u,
+        0x84ec3c97da624ab4u, 0xbd5af13bef0b113eu,
+        0xa6274bbdd0fadd61u, 0xecb1ad8aeacdd58eu,
+        0xcfb11ead453994bau, 0x67de18eda5814af2u,
+        0x81ceb32c4b43fcf4u, 0x80eacf948770ced7u,
+        0xa2425ff75e14fc31u, 0xa1258379a94d028du,
+        0xcad2f7f5359a3b3eu, 0x096ee45813a04330u,
+        0xfd87b5f28300ca0du, 0x8bca9d6e188853fcu,
+        0x9e74d1b791e07e48u, 0x775ea264cf55347eu,
+        0xc612062576589ddau, 0x95364afe032a819eu,
+        0xf79687aed3eec551u, 0x3a83ddbd83f52205u,
+        0x9abe14cd44753b52u, 0xc4926a9672793543u,
+        0xc16d9a0095928a27u, 0x75b7053c0f178294u,
+        0xf1c90080baf72cb1u, 0x5324c68b12dd6339u,
+        0x971da05074da7beeu, 0xd3f6fc16ebca5e04u,
+        0xbce5086492111aeau, 0x88f4bb1ca6bcf585u,
+        0xec1e4a7db69561a5u, 0x2b31e9e3d06c32e6u,
+        0x9392ee8e921d5d07u, 0x3aff322e62439fd0u,
+        0xb877aa3236a4b449u, 0x09befeb9fad487c3u,
+        0xe69594bec44de15bu, 0x4c2ebe687989a9b4u,
+        0x901d7cf73ab0acd9u, 0x0f9d37014bf60a11u,
+        0xb424dc35095cd80fu, 0x538484c19ef38c95u,
+        0xe12e13424bb40e13u, 0x2865a5f206b06fbau,
+        0x8cbccc096f5088cbu, 0xf93f87b7442e45d4u,
+        0xafebff0bcb24aafeu, 0xf78f69a51539d749u,
+        0xdbe6fecebdedd5beu, 0xb573440e5a884d1cu,
+        0x89705f4136b4a597u, 0x31680a88f8953031u,
+        0xabcc77118461cefcu, 0xfdc20d2b36ba7c3eu,
+        0xd6bf94d5e57a42bcu, 0x3d32907604691b4du,
+        0x8637bd05af6c69b5u, 0xa63f9a49c2c1b110u,
+        0xa7c5ac471b478423u, 0x0fcf80dc33721d54u,
+        0xd1b71758e219652bu, 0xd3c36113404ea4a9u,
+        0x83126e978d4fdf3bu, 0x645a1cac083126eau,
+        0xa3d70a3d70a3d70au, 0x3d70a3d70a3d70a4u,
+        0xccccccccccccccccu, 0xcccccccccccccccdu,
+        0x8000000000000000u, 0x0000000000000000u,
+        0xa000000000000000u, 0x0000000000000000u,
+        0xc800000000000000u, 0x0000000000000000u,
+        0xfa00000000000000u, 0x0000000000000000u,
+        0x9c40000000000000u, 0x0000000000000000u,
+        0xc350000000000000u, 0x0000000000000000u,
+        0xf424000000000000u, 0x0000000000000000u,
+        0x9896800000000000u, 0x0000000000000000u,
+        0xbebc200000000000u, 0x0000000000000000u,
+        0xee6b280000000000u, 0x0000000000000000u,
+        0x9502f90000000000u, 0x0000000000000000u,
+        0xba43b74000000000u, 0x0000000000000000u,
+        0xe8d4a51000000000u, 0x0000000000000000u,
+        0x9184e72a00000000u, 0x0000000000000000u,
+        0xb5e620f480000000u, 0x0000000000000000u,
+        0xe35fa931a0000000u, 0x0000000000000000u,
+        0x8e1bc9bf04000000u, 0x0000000000000000u,
+        0xb1a2bc2ec5000000u, 0x0000000000000000u,
+        0xde0b6b3a76400000u, 0x0000000000000000u,
+        0x8ac7230489e80000u, 0x0000000000000000u,
+        0xad78ebc5ac620000u, 0x0000000000000000u,
+        0xd8d726b7177a8000u, 0x0000000000000000u,
+        0x878678326eac9000u, 0x0000000000000000u,
+        0xa968163f0a57b400u, 0x0000000000000000u,
+        0xd3c21bcecceda100u, 0x0000000000000000u,
+        0x84595161401484a0u, 0x0000000000000000u,
+        0xa56fa5b99019a5c8u, 0x0000000000000000u,
+        0xcecb8f27f4200f3au, 0x0000000000000000u,
+        0x813f3978f8940984u, 0x4000000000000000u,
+        0xa18f07d736b90be5u, 0x5000000000000000u,
+        0xc9f2c9cd04674edeu, 0xa400000000000000u,
+        0xfc6f7c4045812296u, 0x4d00000000000000u,
+        0x9dc5ada82b70b59du, 0xf020000000000000u,
+        0xc5371912364ce305u, 0x6c28000000000000u,
+        0xf684df56c3e01bc6u, 0xc732000000000000u,
+        0x9a130b963a6c115cu, 0x3c7f400000000000u,
+        0xc097ce7bc90715b3u, 0x4b9f100000000000u,
+        0xf0bdc21abb48db20u, 0x1e86d40000000000u,
+        0x96769950b50d88f4u, 0x1314448000000000u,
+        0xbc143fa4e250eb31u, 0x17d955a000000000u,
+        0xeb194f8e1ae525fdu, 0x5dcfab0800000000u,
+        0x92efd1b8d0cf37beu, 0x5aa1cae500000000u,
+        0xb7abc627050305adu, 0xf14a3d9e40000000u,
+        0xe596b7b0c643c719u, 0x6d9ccd05d0000000u,
+        0x8f7e32ce7bea5c6fu, 0xe4820023a2000000u,
+        0xb35dbf821ae4f38bu, 0xdda2802c8a800000u,
+        0xe0352f62a19e306eu, 0xd50b2037ad200000u,
+        0x8c213d9da502de45u, 0x4526f422cc340000u,
+        0xaf298d050e4395d6u, 0x9670b12b7f410000u,
+        0xdaf3f04651d47b4cu, 0x3c0cdd765f114000u,
+        0x88d8762bf324cd0fu, 0xa5880a69fb6ac800u,
+        0xab0e93b6efee0053u, 0x8eea0d047a457a00u,
+        0xd5d238a4abe98068u, 0x72a4904598d6d880u,
+        0x85a36366eb71f041u, 0x47a6da2b7f864750u,
+        0xa70c3c40a64e6c51u, 0x999090b65f67d924u,
+        0xd0cf4b50cfe20765u, 0xfff4b4e3f741cf6du,
+        0x82818f1281ed449fu, 0xbff8f10e7a8921a4u,
+        0xa321f2d7226895c7u, 0xaff72d52192b6a0du,
+        0xcbea6f8ceb02bb39u, 0x9bf4f8a69f764490u,
+        0xfee50b7025c36a08u, 0x02f236d04753d5b4u,
+        0x9f4f2726179a2245u, 0x01d762422c946590u,
+        0xc722f0ef9d80aad6u, 0x424d3ad2b7b97ef5u,
+        0xf8ebad2b84e0d58bu, 0xd2e0898765a7deb2u,
+        0x9b934c3b330c8577u, 0x63cc55f49f88eb2fu,
+        0xc2781f49ffcfa6d5u, 0x3cbf6b71c76b25fbu,
+        0xf316271c7fc3908au, 0x8bef464e3945ef7au,
+        0x97edd871cfda3a56u, 0x97758bf0e3cbb5acu,
+        0xbde94e8e43d0c8ecu, 0x3d52eeed1cbea317u,
+        0xed63a231d4c4fb27u, 0x4ca7aaa863ee4bddu,
+        0x945e455f24fb1cf8u, 0x8fe8caa93e74ef6au,
+        0xb975d6b6ee39e436u, 0xb3e2fd538e122b44u,
+        0xe7d34c64a9c85d44u, 0x60dbbca87196b616u,
+        0x90e40fbeea1d3a4au, 0xbc8955e946fe31cdu,
+        0xb51d13aea4a488ddu, 0x6babab6398bdbe41u,
+        0xe264589a4dcdab14u, 0xc696963c7eed2dd1u,
+        0x8d7eb76070a08aecu, 0xfc1e1de5cf543ca2u,
+        0xb0de65388cc8ada8u, 0x3b25a55f43294bcbu,
+        0xdd15fe86affad912u, 0x49ef0eb713f39ebeu,
+        0x8a2dbf142dfcc7abu, 0x6e3569326c784337u,
+        0xacb92ed9397bf996u, 0x49c2c37f07965404u,
+        0xd7e77a8f87daf7fbu, 0xdc33745ec97be906u,
+        0x86f0ac99b4e8dafdu, 0x69a028bb3ded71a3u,
+        0xa8acd7c0222311bcu, 0xc40832ea0d68ce0cu,
+        0xd2d80db02aabd62bu, 0xf50a3fa490c30190u,
+        0x83c7088e1aab65dbu, 0x792667c6da79e0fau,
+        0xa4b8cab1a1563f52u, 0x577001b891185938u,
+        0xcde6fd5e09abcf26u, 0xed4c0226b55e6f86u,
+        0x80b05e5ac60b6178u, 0x544f8158315b05b4u,
+        0xa0dc75f1778e39d6u, 0x696361ae3db1c721u,
+        0xc913936dd571c84cu, 0x03bc3a19cd1e38e9u,
+        0xfb5878494ace3a5fu, 0x04ab48a04065c723u,
+        0x9d174b2dcec0e47bu, 0x62eb0d64283f9c76u,
+        0xc45d1df942711d9au, 0x3ba5d0bd324f8394u,
+        0xf5746577930d6500u, 0xca8f44ec7ee36479u,
+        0x9968bf6abbe85f20u, 0x7e998b13cf4e1ecbu,
+        0xbfc2ef456ae276e8u, 0x9e3fedd8c321a67eu,
+        0xefb3ab16c59b14a2u, 0xc5cfe94ef3ea101eu,
+        0x95d04aee3b80ece5u, 0xbba1f1d158724a12u,
+        0xbb445da9ca61281fu, 0x2a8a6e45ae8edc97u,
+        0xea1575143cf97226u, 0xf52d09d71a3293bdu,
+        0x924d692ca61be758u, 0x593c2626705f9c56u,
+        0xb6e0c377cfa2e12eu, 0x6f8b2fb00c77836cu,
+        0xe498f455c38b997au, 0x0b6dfb9c0f956447u,
+        0x8edf98b59a373fecu, 0x4724bd4189bd5eacu,
+        0xb2977ee300c50fe7u, 0x58edec91ec2cb657u,
+        0xdf3d5e9bc0f653e1u, 0x2f2967b66737e3edu,
+        0x8b865b215899f46cu, 0xbd79e0d20082ee74u,
+        0xae67f1e9aec07187u, 0xecd8590680a3aa11u,
+        0xda01ee641a708de9u, 0xe80e6f4820cc9495u,
+        0x884134fe908658b2u, 0x3109058d147fdcddu,
+        0xaa51823e34a7eedeu, 0xbd4b46f0599fd415u,
+        0xd4e5e2cdc1d1ea96u, 0x6c9e18ac7007c91au,
+        0x850fadc09923329eu, 0x03e2cf6bc604ddb0u,
+        0xa6539930bf6bff45u, 0x84db8346b786151cu,
+        0xcfe87f7cef46ff16u, 0xe612641865679a63u,
+        0x81f14fae158c5f6eu, 0x4fcb7e8f3f60c07eu,
+        0xa26da3999aef7749u, 0xe3be5e330f38f09du,
+        0xcb090c8001ab551cu, 0x5cadf5bfd3072cc5u,
+        0xfdcb4fa002162a63u, 0x73d9732fc7c8f7f6u,
+        0x9e9f11c4014dda7eu, 0x2867e7fddcdd9afau,
+        0xc646d63501a1511du, 0xb281e1fd541501b8u,
+        0xf7d88bc24209a565u, 0x1f225a7ca91a4226u,
+        0x9ae757596946075fu, 0x3375788de9b06958u,
+        0xc1a12d2fc3978937u, 0x0052d6b1641c83aeu,
+        0xf209787bb47d6b84u, 0xc0678c5dbd23a49au,
+        0x9745eb4d50ce6332u, 0xf840b7ba963646e0u,
+        0xbd176620a501fbffu, 0xb650e5a93bc3d898u,
+        0xec5d3fa8ce427affu, 0xa3e51f138ab4cebeu,
+        0x93ba47c980e98cdfu, 0xc66f336c36b10137u,
+        0xb8a8d9bbe123f017u, 0xb80b0047445d4184u,
+        0xe6d3102ad96cec1du, 0xa60dc059157491e5u,
+        0x9043ea1ac7e41392u, 0x87c89837ad68db2fu,
+        0xb454e4a179dd1877u, 0x29babe4598c311fbu,
+        0xe16a1dc9d8545e94u, 0xf4296dd6fef3d67au,
+        0x8ce2529e2734bb1du, 0x1899e4a65f58660cu,
+        0xb01ae745b101e9e4u, 0x5ec05dcff72e7f8fu,
+        0xdc21a1171d42645du, 0x76707543f4fa1f73u,
+        0x899504ae72497ebau, 0x6a06494a791c53a8u,
+        0xabfa45da0edbde69u, 0x0487db9d17636892u,
+        0xd6f8d7509292d603u, 0x45a9d2845d3c42b6u,
+        0x865b86925b9bc5c2u, 0x0b8a2392ba45a9b2u,
+        0xa7f26836f282b732u, 0x8e6cac7768d7141eu,
+        0xd1ef0244af2364ffu, 0x3207d795430cd926u,
+        0x8335616aed761f1fu, 0x7f44e6bd49e807b8u,
+        0xa402b9c5a8d3a6e7u, 0x5f16206c9c6209a6u,
+        0xcd036837130890a1u, 0x36dba887c37a8c0fu,
+        0x802221226be55a64u, 0xc2494954da2c9789u,
+        0xa02aa96b06deb0fdu, 0xf2db9baa10b7bd6cu,
+        0xc83553c5c8965d3du, 0x6f92829494e5acc7u,
+        0xfa42a8b73abbf48cu, 0xcb772339ba1f17f9u,
+        0x9c69a97284b578d7u, 0xff2a760414536efbu,
+        0xc38413cf25e2d70du, 0xfef5138519684abau,
+        0xf46518c2ef5b8cd1u, 0x7eb258665fc25d69u,
+        0x98bf2f79d5993802u, 0xef2f773ffbd97a61u,
+        0xbeeefb584aff8603u, 0xaafb550ffacfd8fau,
+        0xeeaaba2e5dbf6784u, 0x95ba2a53f983cf38u,
+        0x952ab45cfa97a0b2u, 0xdd945a747bf26183u,
+        0xba756174393d88dfu, 0x94f971119aeef9e4u,
+        0xe912b9d1478ceb17u, 0x7a37cd5601aab85du,
+        0x91abb422ccb812eeu, 0xac62e055c10ab33au,
+        0xb616a12b7fe617aau, 0x577b986b314d6009u,
+        0xe39c49765fdf9d94u, 0xed5a7e85fda0b80bu,
+        0x8e41ade9fbebc27du, 0x14588f13be847307u,
+        0xb1d219647ae6b31cu, 0x596eb2d8ae258fc8u,
+        0xde469fbd99a05fe3u, 0x6fca5f8ed9aef3bbu,
+        0x8aec23d680043beeu, 0x25de7bb9480d5854u,
+        0xada72ccc20054ae9u, 0xaf561aa79a10ae6au,
+        0xd910f7ff28069da4u, 0x1b2ba1518094da04u,
+        0x87aa9aff79042286u, 0x90fb44d2f05d0842u,
+        0xa99541bf57452b28u, 0x353a1607ac744a53u,
+        0xd3fa922f2d1675f2u, 0x42889b8997915ce8u,
+        0x847c9b5d7c2e09b7u, 0x69956135febada11u,
+        0xa59bc234db398c25u, 0x43fab9837e699095u,
+        0xcf02b2c21207ef2eu, 0x94f967e45e03f4bbu,
+        0x8161afb94b44f57du, 0x1d1be0eebac278f5u,
+        0xa1ba1ba79e1632dcu, 0x6462d92a69731732u,
+        0xca28a291859bbf93u, 0x7d7b8f7503cfdcfeu,
+        0xfcb2cb35e702af78u, 0x5cda735244c3d43eu,
+        0x9defbf01b061adabu, 0x3a0888136afa64a7u,
+        0xc56baec21c7a1916u, 0x088aaa1845b8fdd0u,
+        0xf6c69a72a3989f5bu, 0x8aad549e57273d45u,
+        0x9a3c2087a63f6399u, 0x36ac54e2f678864bu,
+        0xc0cb28a98fcf3c7fu, 0x84576a1bb416a7ddu,
+        0xf0fdf2d3f3c30b9fu, 0x656d44a2a11c51d5u,
+        0x969eb7c47859e743u, 0x9f644ae5a4b1b325u,
+        0xbc4665b596706114u, 0x873d5d9f0dde1feeu,
+        0xeb57ff22fc0c7959u, 0xa90cb506d155a7eau,
+        0x9316ff75dd87cbd8u, 0x09a7f12442d588f2u,
+        0xb7dcbf5354e9beceu, 0x0c11ed6d538aeb2fu,
+        0xe5d3ef282a242e81u, 0x8f1668c8a86da5fau,
+        0x8fa475791a569d10u, 0xf96e017d694487bcu,
+        0xb38d92d760ec4455u, 0x37c981dcc395a9acu,
+        0xe070f78d3927556au, 0x85bbe253f47b1417u,
+        0x8c469ab843b89562u, 0x93956d7478ccec8eu,
+        0xaf58416654a6babbu, 0x387ac8d1970027b2u,
+        0xdb2e51bfe9d0696au, 0x06997b05fcc0319eu,
+        0x88fcf317f22241e2u, 0x441fece3bdf81f03u,
+        0xab3c2fddeeaad25au, 0xd527e81cad7626c3u,
+        0xd60b3bd56a5586f1u, 0x8a71e223d8d3b074u,
+        0x85c7056562757456u, 0xf6872d5667844e49u,
+        0xa738c6bebb12d16cu, 0xb428f8ac016561dbu,
+        0xd106f86e69d785c7u, 0xe13336d701beba52u,
+        0x82a45b450226b39cu, 0xecc0024661173473u,
+        0xa34d721642b06084u, 0x27f002d7f95d0190u,
+        0xcc20ce9bd35c78a5u, 0x31ec038df7b441f4u,
+        0xff290242c83396ceu, 0x7e67047175a15271u,
+        0x9f79a169bd203e41u, 0x0f0062c6e984d386u,
+        0xc75809c42c684dd1u, 0x52c07b78a3e60868u,
+        0xf92e0c3537826145u, 0xa7709a56ccdf8a82u,
+        0x9bbcc7a142b17ccbu, 0x88a66076400bb691u,
+        0xc2abf989935ddbfeu, 0x6acff893d00ea435u,
+        0xf356f7ebf83552feu, 0x0583f6b8c4124d43u,
+        0x98165af37b2153deu, 0xc3727a337a8b704au,
+        0xbe1bf1b059e9a8d6u, 0x744f18c0592e4c5cu,
+        0xeda2ee1c7064130cu, 0x1162def06f79df73u,
+        0x9485d4d1c63e8be7u, 0x8addcb5645ac2ba8u,
+        0xb9a74a0637ce2ee1u, 0x6d953e2bd7173692u,
+        0xe8111c87c5c1ba99u, 0xc8fa8db6ccdd0437u,
+        0x910ab1d4db9914a0u, 0x1d9c9892400a22a2u,
+        0xb54d5e4a127f59c8u, 0x2503beb6d00cab4bu,
+        0xe2a0b5dc971f303au, 0x2e44ae64840fd61du,
+        0x8da471a9de737e24u, 0x5ceaecfed289e5d2u,
+        0xb10d8e1456105dadu, 0x7425a83e872c5f47u,
+        0xdd50f1996b947518u, 0xd12f124e28f77719u,
+        0x8a5296ffe33cc92fu, 0x82bd6b70d99aaa6fu,
+        0xace73cbfdc0bfb7bu, 0x636cc64d1001550bu,
+        0xd8210befd30efa5au, 0x3c47f7e05401aa4eu,
+        0x8714a775e3e95c78u, 0x65acfaec34810a71u,
+        0xa8d9d1535ce3b396u, 0x7f1839a741a14d0du,
+        0xd31045a8341ca07cu, 0x1ede48111209a050u,
+        0x83ea2b892091e44du, 0x934aed0aab460432u,
+        0xa4e4b66b68b65d60u, 0xf81da84d5617853fu,
+        0xce1de40642e3f4b9u, 0x36251260ab9d668eu,
+        0x80d2ae83e9ce78f3u, 0xc1d72b7c6b426019u,
+        0xa1075a24e4421730u, 0xb24cf65b8612f81fu,
+        0xc94930ae1d529cfcu, 0xdee033f26797b627u,
+        0xfb9b7cd9a4a7443cu, 0x169840ef017da3b1u,
+        0x9d412e0806e88aa5u, 0x8e1f289560ee864eu,
+        0xc491798a08a2ad4eu, 0xf1a6f2bab92a27e2u,
+        0xf5b5d7ec8acb58a2u, 0xae10af696774b1dbu,
+        0x9991a6f3d6bf1765u, 0xacca6da1e0a8ef29u,
+        0xbff610b0cc6edd3fu, 0x17fd090a58d32af3u,
+        0xeff394dcff8a948eu, 0xddfc4b4cef07f5b0u,
+        0x95f83d0a1fb69cd9u, 0x4abdaf101564f98eu,
+        0xbb764c4ca7a4440fu, 0x9d6d1ad41abe37f1u,
+        0xea53df5fd18d5513u, 0x84c86189216dc5edu,
+        0x92746b9be2f8552cu, 0x32fd3cf5b4e49bb4u,
+        0xb7118682dbb66a77u, 0x3fbc8c33221dc2a1u,
+        0xe4d5e82392a40515u, 0x0fabaf3feaa5334au,
+        0x8f05b1163ba6832du, 0x29cb4d87f2a7400eu,
+        0xb2c71d5bca9023f8u, 0x743e20e9ef511012u,
+        0xdf78e4b2bd342cf6u, 0x914da9246b255416u,
+        0x8bab8eefb6409c1au, 0x1ad089b6c2f7548eu,
+        0xae9672aba3d0c320u, 0xa184ac2473b529b1u,
+        0xda3c0f568cc4f3e8u, 0xc9e5d72d90a2741eu,
+        0x8865899617fb1871u, 0x7e2fa67c7a658892u,
+        0xaa7eebfb9df9de8du, 0xddbb901b98feeab7u,
+        0xd51ea6fa85785631u, 0x552a74227f3ea565u,
+        0x8533285c936b35deu, 0xd53a88958f87275fu,
+        0xa67ff273b8460356u, 0x8a892abaf368f137u,
+        0xd01fef10a657842cu, 0x2d2b7569b0432d85u,
+        0x8213f56a67f6b29bu, 0x9c3b29620e29fc73u,
+        0xa298f2c501f45f42u, 0x8349f3ba91b47b8fu,
+        0xcb3f2f7642717713u, 0x241c70a936219a73u,
+        0xfe0efb53d30dd4d7u, 0xed238cd383aa0110u,
+        0x9ec95d1463e8a506u, 0xf4363804324a40aau,
+        0xc67bb4597ce2ce48u, 0xb143c6053edcd0d5u,
+        0xf81aa16fdc1b81dau, 0xdd94b7868e94050au,
+        0x9b10a4e5e9913128u, 0xca7cf2b4191c8326u,
+        0xc1d4ce1f63f57d72u, 0xfd1c2f611f63a3f0u,
+        0xf24a01a73cf2dccfu, 0xbc633b39673c8cecu,
+        0x976e41088617ca01u, 0xd5be0503e085d813u,
+        0xbd49d14aa79dbc82u, 0x4b2d8644d8a74e18u,
+        0xec9c459d51852ba2u, 0xddf8e7d60ed1219eu,
+        0x93e1ab8252f33b45u, 0xcabb90e5c942b503u,
+        0xb8da1662e7b00a17u, 0x3d6a751f3b936243u,
+        0xe7109bfba19c0c9du, 0x0cc512670a783ad4u,
+        0x906a617d450187e2u, 0x27fb2b80668b24c5u,
+        0xb484f9dc9641e9dau, 0xb1f9f660802dedf6u,
+        0xe1a63853bbd26451u, 0x5e7873f8a0396973u,
+        0x8d07e33455637eb2u, 0xdb0b487b6423e1e8u,
+        0xb049dc016abc5e5fu, 0x91ce1a9a3d2cda62u,
+        0xdc5c5301c56b75f7u, 0x7641a140cc7810fbu,
+        0x89b9b3e11b6329bau, 0xa9e904c87fcb0a9du,
+        0xac2820d9623bf429u, 0x546345fa9fbdcd44u,
+        0xd732290fbacaf133u, 0xa97c177947ad4095u,
+        0x867f59a9d4bed6c0u, 0x49ed8eabcccc485du,
+        0xa81f301449ee8c70u, 0x5c68f256bfff5a74u,
+        0xd226fc195c6a2f8cu, 0x73832eec6fff3111u,
+        0x83585d8fd9c25db7u, 0xc831fd53c5ff7eabu,
+        0xa42e74f3d032f525u, 0xba3e7ca8b77f5e55u,
+        0xcd3a1230c43fb26fu, 0x28ce1bd2e55f35ebu,
+        0x80444b5e7aa7cf85u, 0x7980d163cf5b81b3u,
+        0xa0555e361951c366u, 0xd7e105bcc332621fu,
+        0xc86ab5c39fa63440u, 0x8dd9472bf3fefaa7u,
+        0xfa856334878fc150u, 0xb14f98f6f0feb951u,
+        0x9c935e00d4b9d8d2u, 0x6ed1bf9a569f33d3u,
+        0xc3b8358109e84f07u, 0x0a862f80ec4700c8u,
+        0xf4a642e14c6262c8u, 0xcd27bb612758c0fau,
+        0x98e7e9cccfbd7dbdu, 0x8038d51cb897789cu,
+        0xbf21e44003acdd2cu, 0xe0470a63e6bd56c3u,
+        0xeeea5d5004981478u, 0x1858ccfce06cac74u,
+        0x95527a5202df0ccbu, 0x0f37801e0c43ebc8u,
+        0xbaa718e68396cffdu, 0xd30560258f54e6bau,
+        0xe950df20247c83fdu, 0x47c6b82ef32a2069u,
+        0x91d28b7416cdd27eu, 0x4cdc331d57fa5441u,
+        0xb6472e511c81471du, 0xe0133fe4adf8e952u,
+        0xe3d8f9e563a198e5u, 0x58180fddd97723a6u,
+        0x8e679c2f5e44ff8fu, 0x570f09eaa7ea7648u,
+    };
+    return table;
+}
+
+template<class T>
+struct binary_format;
+
+template<>
+struct binary_format<float>
+{
+    typedef std::uint32_t bits_type;
+    static constexpr int mantissa_explicit_bits = 23;
+    static constexpr int minimum_exponent = -127;
+    static constexpr int infinite_power = 0xFF;
+    static constexpr int sign_index = 31;
+    static constexpr int min_exponent_round_to_even = -17;
+    static constexpr int max_exponent_round_to_even = 10;
+    static constexpr int smallest_power_of_ten = -64;
+    static constexpr int largest_power_of_ten = 38;
+    static constexpr int max_exponent_fast_path = 10;
+
+    static float exact_power_of_ten(int e)
+    {
+        static const float powers[] = {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+        return powers[e];
+    }
+};
+
+template<>
+struct binary_format<double>
+{
+    typedef std::uint64_t bits_type;
+    static constexpr int mantissa_explicit_bits = 52;
+    static constexpr int minimum_exponent = -1023;
+    static constexpr int infinite_power = 0x7FF;
+    static constexpr int sign_index = 63;
+    static constexpr int min_exponent_round_to_even = -4;
+    static constexpr int max_exponent_round_to_even = 23;
+    static constexpr int smallest_power_of_ten = -342;
+    static constexpr int largest_power_of_ten = 308;
+    static constexpr int max_exponent_fast_path = 22;
+
+    static double exact_power_of_ten(int e)
+    {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        return powers[e];
+    }
+};
+
+struct adjusted_mantissa
+{
+    std::uint64_t mantissa;
+    int power2;
+};
+
+/*
+ * The binary exponent of 10^q, which is floor(q*log2(10)) + 63.
+ */
+inline int power_of_ten_exponent(int q)
+{
+    return (((152170 + 65536)*q) >> 16) + 63;
+}
+
+template<class F>
+adjusted_mantissa compute_float(long long q, std::uint64_t w)
+{
+    adjusted_mantissa answer;
+    if (w == 0 || q < F::smallest_power_of_ten)
+    {
+        answer.mantissa = 0;
+        answer.power2 = 0;
+        return answer;
+    }
+    if (q > F::largest_power_of_ten)
+    {
+        answer.mantissa = 0;
+        answer.power2 = F::infinite_power;
+        return answer;
+    }
+
+    int lz = leading_zeroes(w);
+    w <<= lz;
+
+    /*
+     * Only the upper mantissa_explicit_bits+3 bits of the product matter.
+     * The second half of the power is only needed if the truncation could
+     * have changed them.
+     */
+    int index = 2*(static_cast<int>(q) - smallest_power_of_five);
+    uint128 product = full_multiplication(w, power_of_five_128()[index]);
+    const std::uint64_t precision_mask = ~std::uint64_t(0) >> (F::mantissa_explicit_bits + 3);
+    if ((product.high & precision_mask) == precision_mask)
+    {
+        uint128 second = full_multiplication(w, power_of_five_128()[index + 1]);
+        product.low += second.high;
+        if (second.high > product.low)
+        {
+            ++product.high;
+        }
+    }
+
+    int upperbit = static_cast<int>(product.high >> 63);
+    int shift = upperbit + 64 - F::mantissa_explicit_bits - 3;
+    answer.mantissa = product.high >> shift;
+    answer.power2 = power_of_ten_exponent(static_cast<int>(q)) + upperbit - lz - F::minimum_exponent;
+
+    if (answer.power2 <= 0)
+    {
+        /* subnormal, or zero if all bits are shifted out */
+        if (-answer.power2 + 1 >= 64)
+        {
+            answer.mantissa = 0;
+            answer.power2 = 0;
+            return answer;
+        }
+        answer.mantissa >>= -answer.power2 + 1;
+        answer.mantissa += answer.mantissa & 1;
+        answer.mantissa >>= 1;
+
+        /* Rounding can carry into the smallest normal number. */
+        answer.power2 = answer.mantissa < (std::uint64_t(1) << F::mantissa_explicit_bits) ? 0 : 1;
+        return answer;
+    }
+
+    /*
+     * For small q an exact product can lie halfway between two floats, in
+     * which case it is rounded to even instead of up.
+     */
+    if (product.low <= 1 &&
+        q >= F::min_exponent_round_to_even &&
+        q <= F::max_exponent_round_to_even &&
+        (answer.mantissa & 3) == 1)
+    {
+        if ((answer.mantissa << shift) == product.high)
+        {
+            answer.mantissa &= ~std::uint64_t(1);
+        }
+    }
+
+    answer.mantissa += answer.mantissa & 1;
+    answer.mantissa >>= 1;
+    if (answer.mantissa >= (std::uint64_t(2) << F::mantissa_explicit_bits))
+    {
+        answer.mantissa = std::uint64_t(1) << F::mantissa_explicit_bits;
+        ++answer.power2;
+    }
+    answer.mantissa &= ~(std::uint64_t(1) << F::mantissa_explicit_bits);
+
+    if (answer.power2 >= F::infinite_power)
+    {
+        answer.mantissa = 0;
+        answer.power2 = F::infinite_power;
+    }
+    return answer;
+}
+
+template<class T>
+T to_float(adjusted_mantissa am)
+{
+    typedef typename binary_format<T>::bits_type bits_type;
+    bits_type bits = static_cast<bits_type>(
+        am.mantissa |
+        (static_cast<std::uint64_t>(am.power2) << binary_format<T>::mantissa_explicit_bits));
+    T x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/*
+ * The digits of a column, without sign and with the decimal separator and
+ * exponent split off, as needed by the strtod fallback.
+ */
+struct decimal_text
+{
+    const char *int_begin;
+    const char *int_end;
+    const char *frac_begin;
+    const char *frac_end;
+    int exponent;
+};
+
+inline float string_to_float(const char *s, float)             { return std::strtof(s, nullptr); }
+inline double string_to_float(const char *s, double)           { return std::strtod(s, nullptr); }
+inline long double string_to_float(const char *s, long double) { return std::strtold(s, nullptr); }
+
+/*
+ * strtod expects the decimal point of the current locale, so the text is
+ * rebuilt with it.
+ */
+template<class T>
+T parse_float_fallback(const decimal_text &text)
+{
+    std::string s(text.int_begin, text.int_end);
+    s += std::localeconv()->decimal_point;
+    s.append(text.frac_begin, text.frac_end);
+    s += 'e';
+    s += std::to_string(text.exponent);
+    return string_to_float(s.c_str(), T());
+}
+
+template<class T>
+T decimal_to_float(
+    std::uint64_t w,
+    long long q,
+    bool truncated,
+    const decimal_text &text)
+{
+    typedef binary_format<T> F;
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if (!truncated &&
+        q >= -F::max_exponent_fast_path &&
+        q <= F::max_exponent_fast_path &&
+        w <= (std::uint64_t(2) << F::mantissa_explicit_bits))
+    {
+        T x = static_cast<T>(w);
+        if (q < 0)
+        {
+            return x / F::exact_power_of_ten(static_cast<int>(-q));
+        }
+        return x * F::exact_power_of_ten(static_cast<int>(q));
+    }
+#endif
+
+    adjusted_mantissa am = compute_float<F>(q, w);
+    if (truncated)
+    {
+        /*
+         * The exact value lies between w*10^q and (w+1)*10^q. If both
+         * round to the same float, so does the value.
+         */
+        adjusted_mantissa upper = compute_float<F>(q, w + 1);
+        if (upper.mantissa != am.mantissa || upper.power2 != am.power2)
+        {
+            return parse_float_fallback<T>(text);
+        }
+    }
+    return to_float<T>(am);
+}
+
+inline float decimal_to_float(std::uint64_t w, long long q, bool truncated, const decimal_text &text, float)
+{
+    return decimal_to_float<float>(w, q, truncated, text);
+}
+
+inline double decimal_to_float(std::uint64_t w, long long q, bool truncated, const decimal_text &text, double)
+{
+    return decimal_to_float<double>(w, q, truncated, text);
+}
+
+/*
+ * long double has the format of double on some platforms, and is 80 bit
+ * x87 or 128 bit IEEE on others. For the latter only Clinger's fast path
+ * is done here, with the powers of ten that are exact in the mantissa.
+ */
+inline long double decimal_to_float(std::uint64_t w, long long q, bool truncated, const decimal_text &text, long double)
+{
+    typedef std::numeric_limits<long double> limits;
+    if (limits::digits == std::numeric_limits<double>::digits)
+    {
+        return decimal_to_float<double>(w, q, truncated, text);
+    }
+
+    const int max_exact_exponent =
+        !limits::is_iec559 ? -1 :
+        limits::digits >= 113 ? 48 :
+        limits::digits >= 64 ? 27 : -1;
+
+    if (w == 0)
+    {
+        return 0;
+    }
+    if (!truncated && q >= -max_exact_exponent && q <= max_exact_exponent)
+    {
+        long double power = 1;
+        for (long long i = q < 0 ? -q : q; i != 0; --i)
+        {
+            power *= 10;
+        }
+        long double x = static_cast<long double>(w);
+        return q < 0 ? x / power : x * power;
+    }
+    return parse_float_fallback<long double>(text);
+}
+
+template<class T, class Err>
+bool parse_float(
+    const char *col,
+    T &x,
+    Err &err)
+{
+    bool is_neg = false;
+    if(*col == '-')
+    {
+        is_neg = true;
+        ++col;
+    }
+    else if(*col == '+')
+    {
+        ++col;
+    }
+
+    /*
+     * w holds the first 19 significant digits, later digits only move the
+     * decimal exponent q or set truncated if they are not zero.
+     */
+    std::uint64_t w = 0;
+    int digit_count = 0;
+    long long q = 0;
+    bool truncated = false;
+
+    decimal_text text;
+    text.int_begin = col;
+    while('0' <= *col && *col <= '9')
+    {
+        int y = *col - '0';
+        if (digit_count < 19)
+        {
+            w = 10*w + y;
+            digit_count += w != 0;
+        }
+        else
+        {
+            ++q;
+            truncated |= y != 0;
+        }
+        ++col;
+    }
+    text.int_end = col;
+    text.frac_begin = col;
+    text.frac_end = col;
+
+    if(*col == '.'|| *col == ',')
+    {
+        ++col;
+        text.frac_begin = col;
+        while('0' <= *col && *col <= '9')
+        {
+            int y = *col - '0';
+            if (digit_count < 19)
+            {
+                w = 10*w + y;
+                digit_count += w != 0;
+                --q;
+            }
+            else
+            {
+                truncated |= y != 0;
+            }
+            ++col;
+        }
+        text.frac_end = col;
+    }
+
+    text.exponent = 0;
+    if(*col == 'e' || *col == 'E')
+    {
+        ++col;
+        if (!parse_signed_integer<set_to_max_on_overflow>(col, text.exponent, err))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if(*col != '\0')
+        {
+            raise_error<error::no_digit>(err);
+            return false;
+        }
+    }
+
+    q += text.exponent;
+    x = decimal_to_float(w, q, truncated, text, T());
+
+    if(is_neg)
+    {
+        x = -x;
+    }
+
+    return true;
+}
+
+template<class overflow_policy, class Err> bool parse(char *col, float &x, Err &err) { return parse_float(col, x, err); }
+template<class overflow_policy, class Err> bool parse(char *col, double &x, Err &err) { return parse_float(col, x, err); }
+template<class overflow_policy, class Err> bool parse(char *col, long double &x, Err &err) { return parse_float(col, x, err); }
+
+template<class overflow_policy, class T, class Err>
+void parse(
+    char *col,
+    T &x,
+    Err &err)
+{
+    /* Mute unused variable compiler warning */
+    (void)col;
+    (void)x;
+    (void)err;
+
+    /*
+     * GCC evalutes "false" when reading the template and
+     * "sizeof(T)!=sizeof(T)" only when instantiating it. This is why
+     * this strange construct is used.
+     */
+    static_assert(
+        sizeof(T)!=sizeof(T),
+        "Can not parse this type. Only buildin integrals, floats, char, char*, "
+        "const char* and std::string are supported");
+}
+
+/*
+ * Converts the chopped columns of a row into the given variables. Columns
+ * that are missing in the file (null entries) leave the variable untouched.
+ */
+template<class overflow_policy, class Err>
+bool parse_columns(
+    char *const *,
+    const std::string *,
+    Err &)
+{
+    return true;
+}
+
+template<class overflow_policy, class Err, class T, class ...ColType>
+bool parse_columns(
+    char *const *row,
+    const std::string *column_names,
+    Err &err,
+    T &t,
+    ColType &...cols)
+{
+    if(*row)
+    {
+        if (!parse<overflow_policy>(*row, t, err))
+        {
+            set_error_column(err, column_names->c_str(), *row);
+            return false;
+        }
+    }
+    return parse_columns<overflow_policy>(row+1, column_names+1, err, cols...);
+}
+
+template<class T>
+struct is_unchecked_integer:
+    std::integral_constant<
+        bool,
+        std::is_integral<T>::value &&
+        !std::is_same<T, char>::value &&
+        !std::is_same<T, bool>::value>
+{
+};
+
+/*
+ * Conversions of the no_error_check policy. Integers are accumulated digit
+ * by digit with a single test for the terminator per character.
+ */
+template<class overflow_policy, class T>
+void parse_unchecked(
+    char *col,
+    T &x,
+    std::true_type)
+{
+    typedef typename std::make_unsigned<T>::type U;
+    bool negative = std::is_signed<T>::value && *col == '-';
+    if(negative || *col == '+')
+    {
+        ++col;
+    }
+    U value = 0;
+    while(*col != '\0')
+    {
+        value = static_cast<U>(10*value + static_cast<U>(*col - '0'));
+        ++col;
+    }
+    x = static_cast<T>(negative ? static_cast<U>(0 - value) : value);
+}
+
+template<class overflow_policy, class T>
+void parse_unchecked(
+    char *col,
+    T &x,
+    std::false_type)
+{
+    error::status ignored;
+    parse<overflow_policy>(col, x, ignored);
+}
+
+template<class overflow_policy>
+void parse_columns_unchecked(
+    char *const *)
+{
+}
+
+template<class overflow_policy, class T, class ...ColType>
+void parse_columns_unchecked(
+    char *const *row,
+    T &t,
+    ColType &...cols)
+{
+    if(*row)
+    {
+        parse_unchecked<overflow_policy>(*row, t, typename is_unchecked_integer<T>::type());
+    }
+    parse_columns_unchecked<overflow_policy>(row+1, cols...);
+}
+
+inline void emplace_back_columns()
+{
+}
+
+template<class T, class ...ColType>
+void emplace_back_columns(std::vector<T> &col, std::vector<ColType> &...cols)
+{
+    col.emplace_back();
+    emplace_back_columns(cols...);
+}
+
+inline void pop_back_columns()
+{
+}
+
+template<class T, class ...ColType>
+void pop_back_columns(std::vector<T> &col, std::vector<ColType> &...cols)
+{
+    col.pop_back();
+    pop_back_columns(cols...);
+}
+
+
+
+#ifdef CSV_IO_ARROW
+
+/*
+ * Memory behind an exported ArrowArray or ArrowSchema. It is owned by the
+ * exported struct and freed by its release callback.
+ */
+struct arrow_array_data
+{
+    virtual ~arrow_array_data() = default;
+
+    const void *buffers[3];
+    std::vector<ArrowArray> children;
+    std::vector<ArrowArray*> child_pointers;
+};
+
+struct arrow_schema_data
+{
+    std::string name;
+    std::vector<ArrowSchema> children;
+    std::vector<ArrowSchema*> child_pointers;
+};
+
+inline void release_arrow_array(ArrowArray *array)
+{
+    for (std::int64_t i = 0; i < array->n_children; ++i)
+    {
+        ArrowArray *child = array->children[i];
+        if (child->release != nullptr)
+        {
+            child->release(child);
+        }
+    }
+    delete static_cast<arrow_array_data*>(array->private_data);
+    array->release = nullptr;
+}
+
+inline void release_arrow_schema(ArrowSchema *schema)
+{
+    for (std::int64_t i = 0; i < schema->n_children; ++i)
+    {
+        ArrowSchema *child = schema->children[i];
+        if (child->release != nullptr)
+        {
+            child->release(child);
+        }
+    }
+    delete static_cast<arrow_schema_data*>(schema->private_data);
+    schema->release = nullptr;
+}
+
+inline void init_arrow_schema(
+    ArrowSchema *schema,
+    const char *format,
+    const std::string &name,
+    std::int64_t flags,
+    std::size_t child_count)
+{
+    arrow_schema_data *data = new arrow_schema_data;
+    data->name = name;
+    data->children.resize(child_count);
+    for (ArrowSchema &child : data->children)
+    {
+        data->child_pointers.push_back(&child);
+    }
+
+    schema->format = format;
+    schema->name = data->name.c_str();
+    schema->metadata = nullptr;
+    schema->flags = flags;
+    schema->n_children = static_cast<std::int64_t>(child_count);
+    schema->children = child_count != 0 ? data->child_pointers.data() : nullptr;
+    schema->dictionary = nullptr;
+    schema->release = release_arrow_schema;
+    schema->private_data = data;
+}
+
+inline void init_arrow_array(
+    ArrowArray *array,
+    arrow_array_data *data,
+    std::int64_t length,
+    std::int64_t null_count,
+    std::int64_t buffer_count)
+{
+    array->length = length;
+    array->null_count = null_count;
+    array->offset = 0;
+    array->n_buffers = buffer_count;
+    array->n_children = static_cast<std::int64_t>(data->children.size());
+    array->buffers = data->buffers;
+    array->children = data->children.empty() ? nullptr : data->child_pointers.data();
+    array->dictionary = nullptr;
+    array->release = release_arrow_array;
+    array->private_data = data;
+}
+
+class arrow_validity
+{
+public:
+    void push_back(bool valid)
+    {
+        if (length % 8 == 0)
+        {
+            bits.push_back(0);
+        }
+        if (valid)
+        {
+            bits.back() |= static_cast<std::uint8_t>(1u << (length % 8));
+        }
+        else
+        {
+            ++null_count;
+        }
+        ++length;
+    }
+
+    void pop_back()
+    {
+        --length;
+        std::uint8_t mask = static_cast<std::uint8_t>(1u << (length % 8));
+        if ((bits.back() & mask) == 0)
+        {
+            --null_count;
+        }
+        bits.back() &= static_cast<std::uint8_t>(~mask);
+        if (length % 8 == 0)
+        {
+            bits.pop_back();
+        }
+    }
+
+    /* The bitmap may be omitted if there are no nulls. */
+    const void *get_buffer() const
+    {
+        return null_count != 0 ? bits.data() : nullptr;
+    }
+
+    std::vector<std::uint8_t> bits;
+    std::int64_t length = 0;
+    std::int64_t null_count = 0;
+};
+
+template<class T>
+const char *arrow_format()
+{
+    static_assert(
+        (std::is_integral<T>::value &&
+            !std::is_same<T, bool>::value && !std::is_same<T, char>::value) ||
+        std::is_same<T, float>::value || std::is_same<T, double>::value,
+        "Arrow columns must be integers, float, double or std::string");
+
+    return
+        std::is_same<T, float>::value ? "f" :
+        std::is_same<T, double>::value ? "g" :
+        sizeof(T) == 1 ? (std::is_signed<T>::value ? "c" : "C") :
+        sizeof(T) == 2 ? (std::is_signed<T>::value ? "s" : "S") :
+        sizeof(T) == 4 ? (std::is_signed<T>::value ? "i" : "I") :
+                         (std::is_signed<T>::value ? "l" : "L");
+}
+
+/*
+ * Builds one column of a record batch. Missing columns and empty fields
+ * become nulls.
+ */
+template<class T>
+class arrow_column
+{
+private:
+    struct column_data : arrow_array_data
+    {
+        arrow_validity validity;
+        std::vector<T> values;
+    };
+
+    std::unique_ptr<column_data> data;
+
+public:
+    arrow_column():
+        data(new column_data)
+    {
+        data->values.reserve(1);
+    }
+
+    static const char *format()
+    {
+        return arrow_format<T>();
+    }
+
+    template<class overflow_policy, class Err>
+    bool push_back(
+        char *field,
+        Err &err)
+    {
+        T value = T();
+        bool valid = field != nullptr && *field != '\0';
+        if (valid && !parse<overflow_policy>(field, value, err))
+        {
+            return false;
+        }
+        data->validity.push_back(valid);
+        data->values.push_back(value);
+        return true;
+    }
+
+    void pop_back()
+    {
+        data->validity.pop_back();
+        data->values.pop_back();
+    }
+
+    bool is_full() const
+    {
+        return false;
+    }
+
+    void export_array(ArrowArray *array)
+    {
+        data->buffers[0] = data->validity.get_buffer();
+        data->buffers[1] = data->values.data();
+        init_arrow_array(array, data.get(), data->validity.length, data->validity.null_count, 2);
+        data.release();
+    }
+};
+
+template<>
+class arrow_column<std::string>
+{
+private:
+    struct column_data : arrow_array_data
+    {
+        arrow_validity validity;
+        std::vector<std::int32_t> offsets;
+        std::string values;
+    };
+
+    std::unique_ptr<column_data> data;
+
+    /*
+     * Offsets are 32 bit. Rows are limited to 2^29 bytes, so a batch that
+     * ends once this is reached cannot overflow them.
+     */
+    static const std::size_t max_values_size = std::size_t(1) << 30;
+
+public:
+    arrow_column():
+        data(new column_data)
+    {
+        data->offsets.push_back(0);
+        data->values.reserve(1);
+    }
+
+    static const char *format()
+    {
+        return "u";
+    }
+
+    template<class overflow_policy, class Err>
+    bool push_back(
+        char *field,
+        Err &err)
+    {
+        if (field != nullptr)
+        {
+            std::size_t len = std::strlen(field);
+            if (data->values.size() + len > static_cast<std::size_t>((std::numeric_limits<std::int32_t>::max)()))
+            {
+                raise_internal_error(err, "Internal error: string column of an Arrow batch exceeds 2 GiB");
+                return false;
+            }
+            data->values.append(field, len);
+        }
+        data->validity.push_back(field != nullptr);
+        data->offsets.push_back(static_cast<std::int32_t>(data->values.size()));
+        return true;
+    }
+
+    void pop_back()
+    {
+        data->validity.pop_back();
+        data->offsets.pop_back();
+        data->values.resize(data->offsets.back());
+    }
+
+    bool is_full() const
+    {
+        return data->values.size() >= max_values_size;
+    }
+
+    void export_array(ArrowArray *array)
+    {
+        data->buffers[0] = data->validity.get_buffer();
+        data->buffers[1] = data->offsets.data();
+        data->buffers[2] = data->values.data();
+        init_arrow_array(array, data.get(), data->validity.length, data->validity.null_count, 3);
+        data.release();
+    }
+};
+
+template<class overflow_policy, std::size_t I, class Columns, class Err>
+typename std::enable_if<I == std::tuple_size<Columns>::value, bool>::type
+push_back_arrow_row(
+    Columns &,
+    char *const *,
+    const std::string *,
+    Err &)
+{
+    return true;
+}
+
+/*
+ * Appends the fields of a row. If a field cannot be parsed, the fields in
+ * front of it are removed again, so that all columns keep the same length.
+ */
+template<class overflow_policy, std::size_t I, class Columns, class Err>
+typename std::enable_if<I < std::tuple_size<Columns>::value, bool>::type
+push_back_arrow_row(
+    Columns &columns,
+    char *const *row,
+    const std::string *column_names,
+    Err &err)
+{
+    if (!std::get<I>(columns).template push_back<overflow_policy>(row[I], err))
+    {
+        detail::set_error_column(err, column_names[I].c_str(), row[I] != nullptr ? row[I] : "");
+        return false;
+    }
+    if (!push_back_arrow_row<overflow_policy, I+1>(columns, row, column_names, err))
+    {
+        std::get<I>(columns).pop_back();
+        return false;
+    }
+    return true;
+}
+
+template<std::size_t I, class Columns>
+typename std::enable_if<I == std::tuple_size<Columns>::value, bool>::type
+is_arrow_batch_full(const Columns &)
+{
+    return false;
+}
+
+template<std::size_t I, class Columns>
+typename std::enable_if<I < std::tuple_size<Columns>::value, bool>::type
+is_arrow_batch_full(const Columns &columns)
+{
+    return std::get<I>(columns).is_full() || is_arrow_batch_full<I+1>(columns);
+}
+
+template<std::size_t I, class Columns>
+typename std::enable_if<I == std::tuple_size<Columns>::value>::type
+export_arrow_columns(
+    Columns &,
+    const std::string *,
+    ArrowArray *,
+    ArrowSchema *)
+{
+}
+
+template<std::size_t I, class Columns>
+typename std::enable_if<I < std::tuple_size<Columns>::value>::type
+export_arrow_columns(
+    Columns &columns,
+    const std::string *column_names,
+    ArrowArray *array,
+    ArrowSchema *schema)
+{
+    std::get<I>(columns).export_array(array->children[I]);
+    if (schema != nullptr)
+    {
+        init_arrow_schema(
+            schema->children[I],
+            std::get<I>(columns).format(),
+            column_names[I],
+            ARROW_FLAG_NULLABLE,
+            0);
+    }
+    export_arrow_columns<I+1>(columns, column_names, array, schema);
+}
+
+/*
+ * Exports the columns as a struct array with one child per column, which
+ * is how the C data interface represents a record batch.
+ */
+template<class Columns>
+void export_arrow_batch(
+    Columns &columns,
+    const std::string *column_names,
+    std::size_t row_count,
+    ArrowArray *array,
+    ArrowSchema *schema)
+{
+    const std::size_t column_count = std::tuple_size<Columns>::value;
+
+    arrow_array_data *data = new arrow_array_data;
+    data->buffers[0] = nullptr;
+    data->children.resize(column_count);
+    for (ArrowArray &child : data->children)
+    {
+        data->child_pointers.push_back(&child);
+    }
+    init_arrow_array(array, data, static_cast<std::int64_t>(row_count), 0, 1);
+
+    if (schema != nullptr)
+    {
+        init_arrow_schema(schema, "+s", std::string(), 0, column_count);
+    }
+
+    export_arrow_columns<0>(columns, column_names, array, schema);
+}
+
+#endif
+
+} // end namespace detail
+
+////////////////////////////////////////////////////////////////////////////
+//                                Filters                                 //
+////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+#ifdef CSV_IO_X86_SIMD
+/*
+ * Compares 16 bytes at a time as long as a load stays in the 64 byte window
+ * of its first byte. The loads start at bytes that matched the needle and
+ * are therefore part of the field, which makes them safe for the same
+ * reason as in load_eight_bytes. The needle is padded with zeros.
+ */
+__attribute__((no_sanitize_address))
+inline bool field_equals_needle(const char *field, const char *needle, std::size_t len)
+{
+    for (std::size_t i = 0; i <= len; i += 16)
+    {
+        const char *p = field + i;
+        if ((reinterpret_cast<std::uintptr_t>(p) & 63) > 48)
+        {
+            return std::strcmp(p, needle + i) == 0;
+        }
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(needle + i));
+        unsigned equal = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+        std::size_t remaining = len + 1 - i;
+        unsigned wanted = remaining >= 16 ? 0xFFFFu : (1u << remaining) - 1;
+        if ((equal & wanted) != wanted)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+#else
+inline bool field_equals_needle(const char *field, const char *needle, std::size_t)
+{
+    return std::strcmp(field, needle) == 0;
+}
+#endif
+
+} // end namespace detail
+
+/*
+ * Predicates for CSVReader::add_filter. They see the field after trimming
+ * and unescaping, before it is converted.
+ */
+class field_equals
+{
+public:
+    explicit field_equals(const std::string &value):
+        needle(value.c_str()),
+        len(needle.size())
+    {
+        needle.resize((len/16+1)*16, '\0');
+    }
+
+    bool operator()(const char *field) const
+    {
+        return detail::field_equals_needle(field, needle.data(), len);
+    }
+
+private:
+    std::string needle;
+    std::size_t len;
+};
+
+class field_not_equals
+{
+public:
+    explicit field_not_equals(const std::string &value):
+        equals(value){}
+
+    bool operator()(const char *field) const
+    {
+        return !equals(field);
+    }
+
+private:
+    field_equals equals;
+};
+
+/*
+ * Compares the numeric value of the field with a bound. Fields that are empty
+ * or not a number of type T are rejected; overflows saturate.
+ */
+template<class T, class Compare>
+class field_compare
+{
+public:
+    explicit field_compare(T bound_):
+        bound(bound_){}
+
+    bool operator()(const char *field) const
+    {
+        if (*field == '\0')
+        {
+            return false;
+        }
+        T value;
+        error::status ignored;
+        if (!detail::parse<set_to_max_on_overflow>(const_cast<char*>(field), value, ignored))
+        {
+            return false;
+        }
+        return Compare()(value, bound);
+    }
+
+private:
+    T bound;
+};
+
+template<class T> using field_less = field_compare<T, std::less<T>>;
+template<class T> using field_less_equal = field_compare<T, std::less_equal<T>>;
+template<class T> using field_greater = field_compare<T, std::greater<T>>;
+template<class T> using field_greater_equal = field_compare<T, std::greater_equal<T>>;
+
+////////////////////////////////////////////////////////////////////////////
+//                               Aggregates                               //
+////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+template<std::size_t ...I>
+struct index_sequence {};
+
+template<std::size_t N, std::size_t ...I>
+struct make_index_sequence : make_index_sequence<N-1, N-1, I...> {};
+
+template<std::size_t ...I>
+struct make_index_sequence<0, I...>
+{
+    using type = index_sequence<I...>;
+};
+
+/*
+ * Integers are summed in 64 bits with wrap around, floating points in at
+ * least double precision.
+ */
+template<class T, bool = std::is_floating_point<T>::value, bool = std::is_signed<T>::value>
+struct aggregate_sum
+{
+    typedef unsigned long long type;
+};
+
+template<class T, bool is_signed>
+struct aggregate_sum<T, true, is_signed>
+{
+    typedef typename std::conditional<
+        std::is_same<T, long double>::value, long double, double>::type type;
+};
+
+template<class T>
+struct aggregate_sum<T, false, true>
+{
+    typedef long long type;
+};
+
+inline long long add_to_sum(long long sum, long long x)
+{
+    return static_cast<long long>(static_cast<unsigned long long>(sum) + static_cast<unsigned long long>(x));
+}
+
+inline unsigned long long add_to_sum(unsigned long long sum, unsigned long long x) { return sum + x; }
+inline double add_to_sum(double sum, double x) { return sum + x; }
+inline long double add_to_sum(long double sum, long double x) { return sum + x; }
+
+struct aggregate_spill;
+
+} // end namespace detail
+
+/*
+ * Count, sum, minimum and maximum of the values of a numeric column. The
+ * minimum and maximum are only meaningful if the count is not zero.
+ */
+template<class T>
+class column_aggregate
+{
+    static_assert(std::is_arithmetic<T>::value, "Only numeric columns can be aggregated");
+
+public:
+    typedef typename detail::aggregate_sum<T>::type sum_type;
+
+    column_aggregate():
+        count(0), sum(0), min_value(), max_value(){}
+
+    void add(T x)
+    {
+        if (count == 0 || x < min_value)
+        {
+            min_value = x;
+        }
+        if (count == 0 || x > max_value)
+        {
+            max_value = x;
+        }
+        sum = detail::add_to_sum(sum, static_cast<sum_type>(x));
+        ++count;
+    }
+
+    void merge(const column_aggregate &other)
+    {
+        if (other.count == 0)
+        {
+            return;
+        }
+        if (count == 0 || other.min_value < min_value)
+        {
+            min_value = other.min_value;
+        }
+        if (count == 0 || other.max_value > max_value)
+        {
+            max_value = other.max_value;
+        }
+        sum = detail::add_to_sum(sum, other.sum);
+        count += other.count;
+    }
+
+    std::size_t get_count() const { return count; }
+    sum_type get_sum() const { return sum; }
+    T get_min() const { return min_value; }
+    T get_max() const { return max_value; }
+
+    double get_mean() const
+    {
+        if (count == 0)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return static_cast<double>(sum) / static_cast<double>(count);
+    }
+
+private:
+    friend struct detail::aggregate_spill;
+
+    std::size_t count;
+    sum_type sum;
+    T min_value;
+    T max_value;
+};
+
+namespace detail
+{
+
+/*
+ * Converts the chopped columns of a row and adds them to the aggregates.
+ * Missing columns and empty fields are skipped. Nothing is added if a
+ * column can not be converted.
+ */
+template<class overflow_policy, class Err>
+bool accumulate_columns(
+    char *const *,
+    const std::string *,
+    Err &)
+{
+    return true;
+}
+
+template<class overflow_policy, class Err, class T, class ...ColType>
+bool accumulate_columns(
+    char *const *row,
+    const std::string *column_names,
+    Err &err,
+    column_aggregate<T> &aggregate,
+    column_aggregate<ColType> &...aggregates)
+{
+    T value = T();
+    bool present = *row != nullptr && **row != '\0';
+    if (present && !parse<overflow_policy>(*row, value, err))
+    {
+        set_error_column(err, column_names->c_str(), *row);
+        return false;
+    }
+    if (!accumulate_columns<overflow_policy>(row+1, column_names+1, err, aggregates...))
+    {
+        return false;
+    }
+    if (present)
+    {
+        aggregate.add(value);
+    }
+    return true;
+}
+
+} // end namespace detail
+
+////////////////////////////////////////////////////////////////////////////
+//                                Group By                                //
+////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/*
+ * Hands out memory from large blocks that are only freed all at once.
+ */
+class arena
+{
+public:
+    static constexpr std::size_t block_len = 1<<16;
+
+    arena():
+        pos(nullptr), left(0), used(0){}
+
+    char *allocate(std::size_t n)
+    {
+        if (n > left)
+        {
+            std::size_t len = std::max(n, static_cast<std::size_t>(block_len));
+            blocks.emplace_back(new char[len]);
+            pos = blocks.back().get();
+            left = len;
+            used += len;
+        }
+        char *p = pos;
+        pos += n;
+        left -= n;
+        return p;
+    }
+
+    void clear()
+    {
+        blocks.clear();
+        pos = nullptr;
+        left = 0;
+        used = 0;
+    }
+
+    std::size_t size() const
+    {
+        return used;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *pos;
+    std::size_t left;
+    std::size_t used;
+};
+
+/*
+ * An open addressing hash table with linear probing that maps byte strings,
+ * which are copied into an arena, to 32 bit values.
+ */
+class key_table
+{
+public:
+    struct slot
+    {
+        std::uint64_t hash;
+        const char *key;
+        std::uint32_t key_len;
+        std::uint32_t value;
+    };
+
+    key_table()
+    {
+        clear();
+    }
+
+    /*
+     * Returns the slot of the key. A new key is inserted with the value 0,
+     * which the caller sets. The slot is valid until the next insertion.
+     */
+    slot &find_or_insert(std::uint64_t hash, const char *key, std::uint32_t key_len, bool &inserted)
+    {
+        if (2*(count+1) > slots.size())
+        {
+            grow();
+        }
+
+        slot *s = probe(hash, key, key_len);
+        inserted = s->key == nullptr;
+        if (inserted)
+        {
+            char *copy = keys.allocate(key_len);
+            std::memcpy(copy, key, key_len);
+            s->hash = hash;
+            s->key = copy;
+            s->key_len = key_len;
+            s->value = 0;
+            ++count;
+        }
+        return *s;
+    }
+
+    const slot *find(std::uint64_t hash, const char *key, std::uint32_t key_len) const
+    {
+        const slot *s = const_cast<key_table*>(this)->probe(hash, key, key_len);
+        return s->key != nullptr ? s : nullptr;
+    }
+
+    /*
+     * Undoes the last insertion, s being the slot that it returned.
+     */
+    void erase_inserted(slot &s)
+    {
+        s = slot();
+        --count;
+    }
+
+    void clear()
+    {
+        keys.clear();
+        slots.assign(1024, slot());
+        count = 0;
+    }
+
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    std::size_t memory_usage() const
+    {
+        return keys.size() + slots.size()*sizeof(slot);
+    }
+
+    const std::vector<slot> &get_slots() const
+    {
+        return slots;
+    }
+
+private:
+    arena keys;
+    std::vector<slot> slots;
+    std::size_t count;
+
+    slot *probe(std::uint64_t hash, const char *key, std::uint32_t key_len)
+    {
+        const std::size_t mask = slots.size() - 1;
+        std::size_t i = hash & mask;
+        while (slots[i].key != nullptr &&
+            !(slots[i].hash == hash && slots[i].key_len == key_len &&
+              std::memcmp(slots[i].key, key, key_len) == 0))
+        {
+            i = (i + 1) & mask;
+        }
+        return &slots[i];
+    }
+
+    void grow()
+    {
+        std::vector<slot> old(slots.size()*2, slot());
+        old.swap(slots);
+        const std::size_t mask = slots.size() - 1;
+        for (const slot &s : old)
+        {
+            if (s.key != nullptr)
+            {
+                std::size_t i = s.hash & mask;
+                while (slots[i].key != nullptr)
+                {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = s;
+            }
+        }
+    }
+};
+
+struct file_closer
+{
+    void operator()(FILE *file) const
+    {
+        std::fclose(file);
+    }
+};
+
+typedef std::unique_ptr<FILE, file_closer> unique_file;
+
+inline bool temporary_file_failed(std::shared_ptr<error::error> &err)
+{
+    int x = errno;
+    err = std::make_shared<error::temporary_file_error>();
+    err->set_errno(x);
+    err->format_error_message();
+    return false;
+}
+
+inline bool temporary_file_failed(error::status &err)
+{
+    err.set_errno(errno);
+    err.set_code(error::code::temporary_file_error);
+    return false;
+}
+
+/*
+ * Number of bytes that hold the value of an arithmetic type. The x87
+ * extended long double only uses the first 10 bytes, the rest is padding
+ * with indeterminate contents that must not end up in a spill file.
+ */
+template<class V>
+struct spill_value_size
+{
+    static constexpr std::size_t value =
+        std::is_same<V, long double>::value && std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(V);
+};
+
+template<class V>
+bool write_spill_value(FILE *file, const V &v)
+{
+    return std::fwrite(&v, 1, spill_value_size<V>::value, file) == spill_value_size<V>::value;
+}
+
+template<class V>
+bool read_spill_value(FILE *file, V &v)
+{
+    v = V();
+    return std::fread(&v, 1, spill_value_size<V>::value, file) == spill_value_size<V>::value;
+}
+
+/*
+ * Writes and reads the fields of a column_aggregate one by one, so that
+ * neither the padding of the aggregate nor the layout of std::tuple end
+ * up in a spill file.
+ */
+struct aggregate_spill
+{
+    template<class T>
+    static bool write(FILE *file, const column_aggregate<T> &a)
+    {
+        return write_spill_value(file, a.count) &&
+            write_spill_value(file, a.sum) &&
+            write_spill_value(file, a.min_value) &&
+            write_spill_value(file, a.max_value);
+    }
+
+    template<class T>
+    static bool read(FILE *file, column_aggregate<T> &a)
+    {
+        return read_spill_value(file, a.count) &&
+            read_spill_value(file, a.sum) &&
+            read_spill_value(file, a.min_value) &&
+            read_spill_value(file, a.max_value);
+    }
+};
+
+template<class Tuple, std::size_t ...I>
+bool write_aggregate_tuple(FILE *file, const Tuple &t, index_sequence<I...>)
+{
+    bool ok = true;
+    int expand[] = {0, (ok = ok && aggregate_spill::write(file, std::get<I>(t)), 0)...};
+    (void)expand;
+    return ok;
+}
+
+template<class Tuple, std::size_t ...I>
+bool read_aggregate_tuple(FILE *file, Tuple &t, index_sequence<I...>)
+{
+    bool ok = true;
+    int expand[] = {0, (ok = ok && aggregate_spill::read(file, std::get<I>(t)), 0)...};
+    (void)expand;
+    return ok;
+}
+
+template<class Tuple, std::size_t ...I>
+void merge_aggregate_tuple(Tuple &to, const Tuple &from, index_sequence<I...>)
+{
+    int expand[] = {(std::get<I>(to).merge(std::get<I>(from)), 0)...};
+    (void)expand;
+}
+
+template<class Callback, class Tuple, std::size_t ...I>
+void deliver_group(Callback &callback, const char *const *keys, const Tuple &t, index_sequence<I...>)
+{
+    callback(keys, std::get<I>(t)...);
+}
+
+} // end namespace detail
+
+/*
+ * Groups rows by the raw bytes of the first key_count columns and
+ * aggregates the remaining ones per group. Rows are added with
+ * CSVReader::group_by. Keys are copied into an arena and looked up in an
+ * open addressing hash table. Once the memory exceeds the budget, the
+ * partial aggregates are spilled to temporary files partitioned by hash,
+ * which are merged one partition at a time by for_each_group. Partitions
+ * that still do not fit are partitioned again.
+ */
+template<unsigned key_count, class ...ColType>
+class hash_group_by
+{
+public:
+    static constexpr std::size_t default_memory_budget = std::size_t(1)<<28;
+
+private:
+    static_assert(key_count >= 1, "at least one key column is needed");
+
+    static constexpr unsigned partition_bits = 4;
+    static constexpr unsigned partition_count = 1u<<partition_bits;
+    static constexpr unsigned max_depth = 64/partition_bits - 1;
+
+    using entry_type = std::tuple<column_aggregate<ColType>...>;
+    using indices = typename detail::make_index_sequence<sizeof...(ColType)>::type;
+
+    using slot = detail::key_table::slot;
+
+    std::size_t memory_budget;
+    detail::key_table table;
+    std::vector<entry_type> entries;
+    std::vector<detail::unique_file> partitions;
+    std::string key_buffer;
+
+    std::size_t memory_usage() const
+    {
+        return table.memory_usage() + entries.capacity()*sizeof(entry_type);
+    }
+
+    void clear_table()
+    {
+        table.clear();
+        entries.clear();
+        entries.shrink_to_fit();
+    }
+
+    /*
+     * Returns the slot of the key, which is inserted with an empty entry
+     * if it is new.
+     */
+    slot &find_or_insert(std::uint64_t hash, const char *key, std::uint32_t key_len, bool &inserted)
+    {
+        slot &s = table.find_or_insert(hash, key, key_len, inserted);
+        if (inserted)
+        {
+            s.value = static_cast<std::uint32_t>(entries.size());
+            entries.emplace_back();
+        }
+        return s;
+    }
+
+    template<class Err>
+    bool after_insert(unsigned depth, std::vector<detail::unique_file> &files, Err &err)
+    {
+        if (memory_usage() > memory_budget && depth <= max_depth)
+        {
+            return spill(depth, files, err);
+        }
+        return true;
+    }
+
+    /*
+     * Writes all groups to the partition files of the given depth, which
+     * are created on demand, and empties the table.
+     */
+    template<class Err>
+    bool spill(unsigned depth, std::vector<detail::unique_file> &files, Err &err)
+    {
+        files.resize(static_cast<std::size_t>(partition_count));
+        const unsigned shift = 64 - partition_bits*(depth+1);
+        for (const slot &s : table.get_slots())
+        {
+            if (s.key == nullptr)
+            {
+                continue;
+            }
+            detail::unique_file &file = files[(s.hash >> shift) & (partition_count-1)];
+            if (!file)
+            {
+                errno = 0;
+                file.reset(std::tmpfile());
+                if (!file)
+                {
+                    return detail::temporary_file_failed(err);
+                }
+            }
+            if (std::fwrite(&s.hash, sizeof(s.hash), 1, file.get()) != 1 ||
+                std::fwrite(&s.key_len, sizeof(s.key_len), 1, file.get()) != 1 ||
+                std::fwrite(s.key, 1, s.key_len, file.get()) != s.key_len ||
+                !detail::write_aggregate_tuple(file.get(), entries[s.value], indices()))
+            {
+                return detail::temporary_file_failed(err);
+            }
+        }
+        clear_table();
+        return true;
+    }
+
+    template<class Callback>
+    void deliver_groups(Callback &callback)
+    {
+        const char *key_ptrs[key_count];
+        for (const slot &s : table.get_slots())
+        {
+            if (s.key == nullptr)
+            {
+                continue;
+            }
+            const char *p = s.key;
+            for (unsigned i = 0; i < key_count; ++i)
+            {
+                key_ptrs[i] = p;
+                p += std::strlen(p) + 1;
+            }
+            detail::deliver_group(callback, key_ptrs, entries[s.value], indices());
+        }
+        clear_table();
+    }
+
+    /*
+     * Merges the groups of a partition file of the given depth. If they do
+     * not fit into the budget they are spilled to the next depth.
+     */
+    template<class Callback>
+    bool merge_partition(FILE *file, unsigned depth, Callback &callback, std::shared_ptr<error::error> &err)
+    {
+        std::rewind(file);
+        std::vector<detail::unique_file> files;
+        std::uint64_t hash;
+        std::uint32_t key_len;
+        entry_type entry;
+        while (std::fread(&hash, sizeof(hash), 1, file) == 1)
+        {
+            errno = 0;
+            if (std::fread(&key_len, sizeof(key_len), 1, file) != 1)
+            {
+                return detail::temporary_file_failed(err);
+            }
+            key_buffer.resize(key_len);
+            if (std::fread(&key_buffer[0], 1, key_len, file) != key_len ||
+                !detail::read_aggregate_tuple(file, entry, indices()))
+            {
+                return detail::temporary_file_failed(err);
+            }
+
+            bool inserted;
+            slot &s = find_or_insert(hash, key_buffer.data(), key_len, inserted);
+            detail::merge_aggregate_tuple(entries[s.value], entry, indices());
+            if (inserted && !after_insert(depth, files, err))
+            {
+                return false;
+            }
+        }
+        if (std::ferror(file))
+        {
+            return detail::temporary_file_failed(err);
+        }
+
+        if (files.empty())
+        {
+            deliver_groups(callback);
+            return true;
+        }
+
+        if (!spill(depth, files, err))
+        {
+            return false;
+        }
+        for (detail::unique_file &f : files)
+        {
+            if (f && !merge_partition(f.get(), depth+1, callback, err))
+            {
+                return false;
+            }
+            f.reset();
+        }
+        return true;
+    }
+
+public:
+    explicit hash_group_by(std::size_t memory_budget_ = default_memory_budget):
+        memory_budget(memory_budget_)
+    {
+        clear_table();
+    }
+
+    hash_group_by(const hash_group_by&) = delete;
+    hash_group_by&operator=(const hash_group_by&) = delete;
+
+    /*
+     * Adds a chopped row, whose first key_count columns form the key.
+     * Missing key columns are treated as empty.
+     */
+    template<class overflow_policy, class Err>
+    bool add_row(
+        char *const *row,
+        const std::string *column_names,
+        Err &err)
+    {
+        const char *key;
+        std::size_t key_len;
+        if (key_count == 1)
+        {
+            key = row[0] != nullptr ? row[0] : "";
+            key_len = std::strlen(key) + 1;
+        }
+        else
+        {
+            key_buffer.clear();
+            for (unsigned i = 0; i < key_count; ++i)
+            {
+                if (row[i] != nullptr)
+                {
+                    key_buffer += row[i];
+                }
+                key_buffer += '\0';
+            }
+            key = key_buffer.data();
+            key_len = key_buffer.size();
+        }
+
+        std::uint64_t hash = detail::hash_bytes(key, key_len);
+        bool inserted;
+        slot &s = find_or_insert(hash, key, static_cast<std::uint32_t>(key_len), inserted);
+        if (!accumulate_entry<overflow_policy>(row + key_count, column_names + key_count, err, entries[s.value], indices()))
+        {
+            if (inserted)
+            {
+                /* Nothing was inserted behind the slot, so it can simply be emptied */
+                table.erase_inserted(s);
+                entries.pop_back();
+            }
+            return false;
+        }
+        return !inserted || after_insert(0, partitions, err);
+    }
+
+    std::size_t get_group_count() const
+    {
+        return entries.size();
+    }
+
+    bool has_spilled() const
+    {
+        return !partitions.empty();
+    }
+
+    /*
+     * Calls callback(keys, aggregate1, aggregate2, ...) for every group in
+     * no particular order and removes all groups. keys points to key_count
+     * null terminated strings that are only valid during the call.
+     */
+    template<class Callback>
+    bool for_each_group(std::shared_ptr<error::error> &err, Callback callback)
+    {
+        if (err)
+        {
+            return false;
+        }
+
+        if (partitions.empty())
+        {
+            deliver_groups(callback);
+            return true;
+        }
+
+        bool success = spill(0, partitions, err);
+        for (detail::unique_file &file : partitions)
+        {
+            if (success && file)
+            {
+                success = merge_partition(file.get(), 1, callback, err);
+            }
+        }
+        partitions.clear();
+        clear_table();
+        return success;
+    }
+
+private:
+    template<class overflow_policy, class Err, std::size_t ...I>
+    static bool accumulate_entry(
+        char *const *row,
+        const std::string *column_names,
+        Err &err,
+        entry_type &entry,
+        detail::index_sequence<I...>)
+    {
+        return detail::accumulate_columns<overflow_policy>(row, column_names, err, std::get<I>(entry)...);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////
+//                                Sorting                                 //
+////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+static constexpr std::size_t max_merge_fan_in = 64;
+static constexpr int run_block_len = 1<<16;
+
+/*
+ * Whether a key type is a pointer, such as char*, which would point into
+ * the row buffer and compare by address.
+ */
+template<class ...T>
+struct has_pointer_key : std::false_type {};
+
+template<class T, class ...Rest>
+struct has_pointer_key<T, Rest...> : std::integral_constant<bool,
+    std::is_pointer<typename std::decay<T>::type>::value || has_pointer_key<Rest...>::value> {};
+
+template<class Key>
+struct sort_entry
+{
+    Key key;
+    std::size_t offset;
+    std::size_t len;
+};
+
+/*
+ * Sorts a run by its keys and writes its lines to file.
+ */
+template<class Key>
+bool write_sorted_run(std::vector<sort_entry<Key>> &entries, const std::vector<char> &text, FILE *file)
+{
+    std::stable_sort(
+        entries.begin(), entries.end(),
+        [](const sort_entry<Key> &a, const sort_entry<Key> &b)
+        {
+            return a.key < b.key;
+        });
+
+    for (const sort_entry<Key> &e : entries)
+    {
+        if (std::fwrite(text.data() + e.offset, 1, e.len, file) != e.len ||
+            std::fputc('\n', file) == EOF)
+        {
+            return false;
+        }
+    }
+    return std::fflush(file) == 0;
+}
+
+} // end namespace detail
+
+////////////////////////////////////////////////////////////////////////////
+//                               CsvReader                                //
+////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Time to put it all together.
+ */
+
+template
+<
+    unsigned column_count,
+    class trim_policy = trim_chars<' ', '\t'>,
+    class quote_policy = no_quote_escape<','>,
+    class overflow_policy = set_to_max_on_overflow,
+    class comment_policy = no_comment,
+    class error_policy = stop_on_error
+>
+class CSVReader
+{
+private:
+    LineReader in;
+
+    char*row[column_count];
+    std::string column_names[column_count];
+    detail::column_name_index column_index;
+    std::vector<int> col_order;
+    bool ignore_trailing = false;
+    std::vector<std::pair<unsigned, std::function<bool(const char*)>>> filters;
+    std::string header_line;
+    std::size_t bad_row_counts[detail::error_code_count] = {};
+    std::vector<unsigned> bad_row_lines;
+    bool valid;
+
+    template<class ...ColNames>
+    void set_column_names(
+        std::string s,
+        ColNames... cols)
+    {
+        column_names[column_count - sizeof...(ColNames)-1] = std::move(s);
+        set_column_names(std::forward<ColNames>(cols)...);
+    }
+
+    void set_column_names()
+    {
+        column_index.assign(column_names, column_count);
+    }
+
+public:
+    static constexpr std::size_t default_sort_memory_budget = std::size_t(1)<<28;
+
+    CSVReader() = delete;
+    CSVReader(const CSVReader&) = delete;
+    CSVReader&operator=(const CSVReader&);
+
+    template<class ...Args>
+    explicit CSVReader(
+        std::shared_ptr<error::error> &err,
+        Args&&...args):
+            in(err, std::forward<Args>(args)...)
+    {
+        if (err)
+        {
+            err->format_error_message();
+            return;
+        }
+
+        std::fill(row, row+column_count, nullptr);
+        col_order.resize(column_count);
+        bad_row_lines.reserve(error_policy::max_recorded_lines);
+
+        for(unsigned i=0; i<column_count; ++i)
+        {
+            col_order[i] = i;
+        }
+
+        for(unsigned i=1; i<=column_count; ++i)
+        {
+            column_names[i-1] = "col"+std::to_string(i);
+        }
+        column_index.assign(column_names, column_count);
+        column_index.set_all_read();
+    }
+
+    char *next_line(std::shared_ptr<error::error> &err)
+    {
+        return do_next_line(err);
+    }
+
+    char *next_line(error::status &err)
+    {
+        return do_next_line(err);
+    }
+
+    /*
+     * Reads the next row that passes the filters without converting it.
+     * Returns the column_count raw fields in the order of the column names,
+     * which are null for missing columns, or null at the end of the file or
+     * on error. The fields are valid until the next row is read.
+     */
+    char *const *read_raw_row(std::shared_ptr<error::error> &err)
+    {
+        if (!error_policy::skips_bad_rows || err)
+        {
+            return do_read_raw_row(err);
+        }
+        error::status status;
+        char *const *r = do_read_raw_row(status);
+        err = status.to_error();
+        return r;
+    }
+
+    char *const *read_raw_row(error::status &err)
+    {
+        return do_read_raw_row(err);
+    }
+
+    template<class ...ColNames>
+    bool read_header(
+        std::shared_ptr<error::error> &err,
+        ignore_column ignore_policy,
+        ColNames...cols)
+    {
+        static_assert(sizeof...(ColNames)>=column_count, "not enough column names specified");
+        static_assert(sizeof...(ColNames)<=column_count, "too many column names specified");
+
+        if (err)
+        {
+            return false;
+        }
+
+        set_column_names(std::forward<ColNames>(cols)...);
+        char *line;
+        do
+        {
+            line = in.next_line(err);
+            if (err)
+            {
+                err->format_error_message();
+                return false;
+            }
+            if(!line)
+            {
+                err = std::make_shared<error::header_missing>();
+                err->set_file_name(get_truncated_file_name());
+                err->format_error_message();
+                return false;
+            }
+        }while(comment_policy::is_comment(line));
+
+        header_line = line;
+        bool success = detail::parse_header_line<trim_policy, quote_policy>(
+            line, col_order, column_index, ignore_policy, err);
+        ignore_trailing = (ignore_policy & ignore_trailing_columns) != 0;
+
+        if (!success)
+        {
+            err->set_file_name(get_truncated_file_name());
+            err->format_error_message();
+        }
+
+        return success;
+    }
+
+    template<class ...ColNames>
+    bool set_header(ColNames...cols)
+    {
+        static_assert(
+            sizeof...(ColNames)>=column_count,
+            "not enough column names specified");
+
+        static_assert(
+            sizeof...(ColNames)<=column_count,
+            "too many column names specified");
+
+        set_column_names(std::forward<ColNames>(cols)...);
+        column_index.set_all_read();
+        std::fill(row, row+column_count, nullptr);
+        col_order.resize(column_count);
+        for(unsigned i=0; i<column_count; ++i)
+        {
+            col_order[i] = i;
+        }
+        ignore_trailing = false;
+        header_line.clear();
+
+        return true;
+    }
+
+    bool has_column(const std::string &name) const
+    {
+        return column_index.has_column(name);
+    }
+
+    /*
+     * Only rows for which pred returns true on the raw field of the column
+     * are returned; the others are dropped before any column is converted.
+     * Call this after read_header or set_header. Returns false if the
+     * column is not read.
+     */
+    template<class Predicate>
+    bool add_filter(const std::string &name, Predicate pred)
+    {
+        if (!has_column(name))
+        {
+            return false;
+        }
+        unsigned index = static_cast<unsigned>(column_index.find(name));
+        filters.emplace_back(index, std::function<bool(const char*)>(std::move(pred)));
+        return true;
+    }
+
+    void clear_filters()
+    {
+        filters.clear();
+    }
+
+    /*
+     * The number of rows dropped by a skip_bad_rows error policy, in total
+     * or for one error::code.
+     */
+    std::size_t get_bad_row_count() const
+    {
+        std::size_t count = 0;
+        for (std::size_t c : bad_row_counts)
+        {
+            count += c;
+        }
+        return count;
+    }
+
+    std::size_t get_bad_row_count(error::code c) const
+    {
+        return bad_row_counts[static_cast<std::size_t>(c)];
+    }
+
+    /*
+     * The line numbers of the first error_policy::max_recorded_lines
+     * dropped rows. The vector is reserved up front, so recording them
+     * does not allocate.
+     */
+    const std::vector<unsigned> &get_bad_row_lines() const
+    {
+        return bad_row_lines;
+    }
+
+    void set_file_name(const std::string &file_name)
+    {
+        in.set_file_name(file_name);
+    }
+
+    void set_file_name(const char *file_name)
+    {
+        in.set_file_name(file_name);
+    }
+
+
+    const char *get_truncated_file_name() const
+    {
+        return in.get_truncated_file_name();
+    }
+
+    void set_file_line(unsigned file_line)
+    {
+        in.set_file_line(file_line);
+    }
+
+    unsigned get_file_line() const
+    {
+        return in.get_file_line();
+    }
+
+    void set_max_line_length(int max_line_length)
+    {
+        in.set_max_line_length(max_line_length);
+    }
+
+    int get_max_line_length() const
+    {
+        return in.get_max_line_length();
+    }
+
+    int get_block_len() const
+    {
+        return in.get_block_len();
+    }
+
+    long long get_byte_offset() const
+    {
+        return in.get_byte_offset();
+    }
+
+    /*
+     * Takes over the column names and order that another reader of the
+     * same file determined with read_header. Use this for readers of a
+     * byte_range that does not contain the header.
+     */
+    void copy_header(const CSVReader &other)
+    {
+        std::copy(
+            std::begin(other.column_names), std::end(other.column_names),
+            std::begin(column_names));
+        column_index = other.column_index;
+        col_order = other.col_order;
+        ignore_trailing = other.ignore_trailing;
+        header_line = other.header_line;
+        std::fill(row, row+column_count, nullptr);
+    }
+
+    /*
+     * If the error policy skips bad rows, the shared_ptr overloads read
+     * through an error::status, so that dropping a row does not allocate.
+     */
+    template<class ...ColType>
+    bool read_row(
+        std::shared_ptr<error::error> &err,
+        ColType& ...cols)
+    {
+        if (!error_policy::skips_bad_rows || err)
+        {
+            return do_read_row(err, cols...);
+        }
+        error::status status;
+        bool ok = do_read_row(status, cols...);
+        err = status.to_error();
+        return ok;
+    }
+
+    /*
+     * The error::status overloads report errors without allocating. The
+     * message is only formatted by error::status::to_error.
+     */
+    template<class ...ColType>
+    bool read_row(
+        error::status &err,
+        ColType& ...cols)
+    {
+        return do_read_row(err, cols...);
+    }
+
+    /*
+     * Appends up to max_rows rows to the column vectors and returns the
+     * number of rows read. Fewer rows are only returned at the end of the
+     * file or if an error occurred, in which case the vectors hold the rows
+     * in front of the faulty one.
+     */
+    template<class ...ColType>
+    std::size_t read_rows(
+        std::shared_ptr<error::error> &err,
+        std::size_t max_rows,
+        std::vector<ColType>& ...cols)
+    {
+        if (!error_policy::skips_bad_rows || err)
+        {
+            return do_read_rows(err, max_rows, cols...);
+        }
+        error::status status;
+        std::size_t count = do_read_rows(status, max_rows, cols...);
+        err = status.to_error();
+        return count;
+    }
+
+    template<class ...ColType>
+    std::size_t read_rows(
+        error::status &err,
+        std::size_t max_rows,
+        std::vector<ColType>& ...cols)
+    {
+        return do_read_rows(err, max_rows, cols...);
+    }
+
+#ifdef CSV_IO_ARROW
+    /*
+     * Reads up to max_rows rows into a record batch of the Arrow C data
+     * interface. ColType gives the C++ type of every column in the order of
+     * the column names, which determines the Arrow type. The schema is only
+     * exported if schema is not null. Returns the number of rows; if it is
+     * 0, nothing is exported and the release callbacks are set to null.
+     */
+    template<class ...ColType>
+    std::size_t read_arrow_batch(
+        std::shared_ptr<error::error> &err,
+        std::size_t max_rows,
+        ArrowArray *array,
+        ArrowSchema *schema = nullptr)
+    {
+        if (!error_policy::skips_bad_rows || err)
+        {
+            return do_read_arrow_batch<ColType...>(err, max_rows, array, schema);
+        }
+        error::status status;
+        std::size_t count = do_read_arrow_batch<ColType...>(status, max_rows, array, schema);
+        err = status.to_error();
+        return count;
+    }
+#endif
+
+    /*
+     * Reads all remaining rows and adds every column to its aggregate in
+     * the order of the column names, without materializing the rows.
+     * Missing columns and empty fields are skipped. On error the aggregates
+     * contain the rows in front of the faulty one.
+     */
+    template<class ...ColType>
+    bool aggregate(
+        std::shared_ptr<error::error> &err,
+        column_aggregate<ColType>& ...aggregates)
+    {
+        if (!error_policy::skips_bad_rows || err)
+        {
+            return do_aggregate(err, aggregates...);
+        }
+        error::status status;
+        bool ok = do_aggregate(status, aggregates...);
+        err = status.to_error();
+        return ok;
+    }
+
+    /*
+     * Reads all remaining rows into groups. The first key_count columns in
+     * the order of the column names are the key, the others are
+     * aggregated.
+     */
+    template<unsigned key_count, class ...ColType>
+    bool group_by(
+        std::shared_ptr<error::error> &err,
+        hash_group_by<key_count, ColType...> &groups)
+    {
+        if (!error_policy::skips_bad_rows || err)
+        {
+            return do_group_by(err, groups);
+        }
+        error::status status;
+        bool ok = do_group_by(status, groups);
+        err = status.to_error();
+        return ok;
+    }
+
+    /*
+     * Writes the remaining rows to the file out_file_name, sorted by the
+     * columns in the order of the column names. KeyType gives the type of
+     * every column and thereby how it compares; use std::string for a
+     * byte wise order. The header line read by read_header is written
+     * first. The rows are copied unchanged and rows with equal keys keep
+     * their order. Comments and filtered rows are dropped.
+     *
+     * Runs of rows that fit into memory_budget bytes are sorted by sorting
+     * their line offsets together with the converted keys. If there is more
+     * than one run, they are written to temporary files and merged.
+     */
+    template<class ...KeyType>
+    bool sort_rows(
+        std::shared_ptr<error::error> &err,
+        const std::string &out_file_name,
+        std::size_t memory_budget = default_sort_memory_budget)
+    {
+        static_assert(
+            sizeof...(KeyType)>=column_count,
+            "not enough columns specified");
+
+        static_assert(
+            sizeof...(KeyType)<=column_count,
+            "too many columns specified");
+
+        static_assert(
+            !detail::has_pointer_key<KeyType...>::value,
+            "char* keys point into the row buffer and compare by address, use std::string");
+
+        if (err)
+        {
+            return false;
+        }
+
+        using key_type = std::tuple<KeyType...>;
+        using indices = typename detail::make_index_sequence<sizeof...(KeyType)>::type;
+
+        std::vector<char> text;
+        std::vector<detail::sort_entry<key_type>> entries;
+        std::vector<detail::unique_file> runs;
+
+        /*
+         * Rows are split and their keys converted through a status, so that
+         * a row dropped by the error policy does not allocate.
+         */
+        error::status row_err;
+
+        for(;;)
+        {
+            char *line = in.next_line(err);
+            if (err)
+            {
+                format_row_error(err);
+                return false;
+            }
+            if (!line)
+            {
+                break;
+            }
+            if (comment_policy::is_comment(line))
+            {
+                continue;
+            }
+
+            std::size_t offset = text.size();
+            text.insert(text.end(), line, line + std::strlen(line));
+            if (!detail::parse_line<trim_policy, quote_policy>(
+                    line, row, col_order, in.get_column_end_index(), row_err, ignore_trailing))
+            {
+                if (skip_bad_row(row_err))
+                {
+                    text.resize(offset);
+                    continue;
+                }
+                format_row_error(row_err);
+                err = row_err.to_error();
+                return false;
+            }
+            if (!passes_filters())
+            {
+                text.resize(offset);
+                continue;
+            }
+
+            entries.emplace_back();
+            entries.back().offset = offset;
+            entries.back().len = text.size() - offset;
+            if (!parse_key(row_err, entries.back().key, indices()))
+            {
+                if (skip_bad_row(row_err))
+                {
+                    entries.pop_back();
+                    text.resize(offset);
+                    continue;
+                }
+                format_row_error(row_err);
+                err = row_err.to_error();
+                return false;
+            }
+
+            if (text.size() + entries.size()*sizeof(entries[0]) > memory_budget)
+            {
+                runs.emplace_back(std::tmpfile());
+                if (!runs.back() ||
+                    !detail::write_sorted_run(entries, text, runs.back().get()))
+                {
+                    return detail::temporary_file_failed(err);
+                }
+                text.clear();
+                entries.clear();
+            }
+        }
+
+        detail::unique_file out(std::fopen(out_file_name.c_str(), "wb"));
+        if (!out)
+        {
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(out_file_name.substr(0, error::max_file_name_length));
+            err->format_error_message();
+            return false;
+        }
+        if (!header_line.empty() &&
+            (std::fwrite(header_line.data(), 1, header_line.size(), out.get()) != header_line.size() ||
+             std::fputc('\n', out.get()) == EOF))
+        {
+            return write_failed(err, out_file_name);
+        }
+
+        if (runs.empty())
+        {
+            if (!detail::write_sorted_run(entries, text, out.get()))
+            {
+                return write_failed(err, out_file_name);
+            }
+        }
+        else
+        {
+            if (!entries.empty())
+            {
+                runs.emplace_back(std::tmpfile());
+                if (!runs.back() ||
+                    !detail::write_sorted_run(entries, text, runs.back().get()))
+                {
+                    return detail::temporary_file_failed(err);
+                }
+            }
+            std::vector<char>().swap(text);
+            std::vector<detail::sort_entry<key_type>>().swap(entries);
+
+            while (runs.size() > detail::max_merge_fan_in)
+            {
+                std::vector<detail::unique_file> merged;
+                for (std::size_t i = 0; i < runs.size(); i += detail::max_merge_fan_in)
+                {
+                    merged.emplace_back(std::tmpfile());
+                    std::size_t end = std::min(runs.size(), i + detail::max_merge_fan_in);
+                    if (!merged.back() ||
+                        !merge_runs<KeyType...>(err, runs.begin() + i, runs.begin() + end, merged.back().get()))
+                    {
+                        return err ? false : detail::temporary_file_failed(err);
+                    }
+                }
+                runs.swap(merged);
+            }
+
+            if (!merge_runs<KeyType...>(err, runs.begin(), runs.end(), out.get()))
+            {
+                return err ? false : write_failed(err, out_file_name);
+            }
+        }
+
+        if (std::fclose(out.release()) != 0)
+        {
+            return write_failed(err, out_file_name);
+        }
+        return true;
+    }
+
+private:
+    template<class Err, class Key, std::size_t ...I>
+    bool parse_key(
+        Err &err,
+        Key &key,
+        detail::index_sequence<I...>)
+    {
+        return detail::parse_columns<overflow_policy>(row, column_names, err, std::get<I>(key)...);
+    }
+
+    static bool write_failed(std::shared_ptr<error::error> &err, const std::string &file_name)
+    {
+        int x = errno;
+        err = std::make_shared<error::cannot_write_file>();
+        err->set_errno(x);
+        err->set_file_name(file_name.substr(0, error::max_file_name_length));
+        err->format_error_message();
+        return false;
+    }
+
+    /*
+     * Merges the sorted runs into out. Ties are resolved in favor of the
+     * earlier run, which keeps the sort stable. The runs are closed.
+     * Returns false with err unset if reading or writing failed.
+     */
+    template<class ...KeyType, class Iterator>
+    bool merge_runs(
+        std::shared_ptr<error::error> &err,
+        Iterator first,
+        Iterator last,
+        FILE *out)
+    {
+        using key_type = std::tuple<KeyType...>;
+        using indices = typename detail::make_index_sequence<sizeof...(KeyType)>::type;
+
+        struct cursor
+        {
+            std::unique_ptr<LineReader> reader;
+            std::string line;
+            key_type key;
+        };
+        std::vector<cursor> cursors(last - first);
+
+        auto advance = [&](cursor &c)
+        {
+            char *line = c.reader->next_line(err);
+            if (err || !line)
+            {
+                return false;
+            }
+            c.line.assign(line);
+            return detail::parse_line<trim_policy, quote_policy>(
+                    line, row, col_order, c.reader->get_column_end_index(), err, ignore_trailing) &&
+                parse_key(err, c.key, indices());
+        };
+
+        auto greater = [&](std::size_t a, std::size_t b)
+        {
+            if (cursors[b].key < cursors[a].key)
+            {
+                return true;
+            }
+            return !(cursors[a].key < cursors[b].key) && a > b;
+        };
+
+        std::vector<std::size_t> heap;
+        for (std::size_t i = 0; first != last; ++first, ++i)
+        {
+            std::rewind(first->get());
+            cursors[i].reader.reset(new LineReader(err, "run", first->release(), detail::run_block_len));
+            cursors[i].reader->set_max_line_length(in.get_max_line_length());
+            if (advance(cursors[i]))
+            {
+                heap.push_back(i);
+            }
+            if (err)
+            {
+                err->format_error_message();
+                return false;
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), greater);
+
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            cursor &c = cursors[heap.back()];
+            if (std::fwrite(c.line.data(), 1, c.line.size(), out) != c.line.size() ||
+                std::fputc('\n', out) == EOF)
+            {
+                return false;
+            }
+            if (advance(c))
+            {
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+            else
+            {
+                heap.pop_back();
+            }
+            if (err)
+            {
+                err->format_error_message();
+                return false;
+            }
+        }
+        return std::fflush(out) == 0;
+    }
+
+#ifdef CSV_IO_ARROW
+    template<class ...ColType, class Err>
+    std::size_t do_read_arrow_batch(
+        Err &err,
+        std::size_t max_rows,
+        ArrowArray *array,
+        ArrowSchema *schema)
+    {
+        array->release = nullptr;
+        if (schema != nullptr)
+        {
+            schema->release = nullptr;
+        }
+
+        if (err)
+        {
+            return 0;
+        }
+
+        static_assert(
+            sizeof...(ColType)>=column_count,
+            "not enough columns specified");
+
+        static_assert(
+            sizeof...(ColType)<=column_count,
+            "too many columns specified");
+
+        std::tuple<detail::arrow_column<ColType>...> columns;
+        std::size_t count = 0;
+        while (count < max_rows && !detail::is_arrow_batch_full<0>(columns) && chop_next_row(err))
+        {
+            if (!detail::push_back_arrow_row<overflow_policy, 0>(columns, row, column_names, err))
+            {
+                if (skip_bad_row(err))
+                {
+                    continue;
+                }
+                format_row_error(err);
+                break;
+            }
+            ++count;
+        }
+
+        if (count != 0)
+        {
+            detail::export_arrow_batch(columns, column_names, count, array, schema);
+        }
+        return count;
+    }
+#endif
+
+    template<class Err, class ...ColType>
+    bool do_aggregate(
+        Err &err,
+        column_aggregate<ColType>& ...aggregates)
+    {
+        if (err)
+        {
+            return false;
+        }
+
+        static_assert(
+            sizeof...(ColType)>=column_count,
+            "not enough columns specified");
+
+        static_assert(
+            sizeof...(ColType)<=column_count,
+            "too many columns specified");
+
+        while (chop_next_row(err))
+        {
+            if (!detail::accumulate_columns<overflow_policy>(row, column_names, err, aggregates...))
+            {
+                if (skip_bad_row(err))
+                {
+                    continue;
+                }
+                format_row_error(err);
+                return false;
+            }
+        }
+
+        return !err;
+    }
+
+    template<class Err, unsigned key_count, class ...ColType>
+    bool do_group_by(
+        Err &err,
+        hash_group_by<key_count, ColType...> &groups)
+    {
+        static_assert(
+            key_count + sizeof...(ColType) == column_count,
+            "the key and aggregate columns must add up to the column count");
+
+        if (err)
+        {
+            return false;
+        }
+
+        while (chop_next_row(err))
+        {
+            if (!groups.template add_row<overflow_policy>(row, column_names, err))
+            {
+                if (skip_bad_row(err))
+                {
+                    continue;
+                }
+                format_row_error(err);
+                return false;
+            }
+        }
+
+        return !err;
+    }
+
+    template<class Err>
+    char *do_next_line(Err &err)
+    {
+        if (err)
+        {
+            return nullptr;
+        }
+
+        return in.next_line(err);
+    }
+
+    template<class Err>
+    char *const *do_read_raw_row(Err &err)
+    {
+        if (err || !chop_next_row(err))
+        {
+            return nullptr;
+        }
+
+        return row;
+    }
+
+    template<class Err, class ...ColType>
+    bool do_read_row(
+        Err &err,
+        ColType& ...cols)
+    {
+        if (err)
+        {
+            return false;
+        }
+
+        static_assert(
+            sizeof...(ColType)>=column_count,
+            "not enough columns specified");
+
+        static_assert(
+            sizeof...(ColType)<=column_count,
+            "too many columns specified");
+
+        while (chop_next_row(err))
+        {
+            if (convert_row(err, cols...))
+            {
+                return true;
+            }
+            if (!skip_bad_row(err))
+            {
+                format_row_error(err);
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    template<class Err, class ...ColType>
+    std::size_t do_read_rows(
+        Err &err,
+        std::size_t max_rows,
+        std::vector<ColType>& ...cols)
+    {
+        if (err)
+        {
+            return 0;
+        }
+
+        static_assert(
+            sizeof...(ColType)>=column_count,
+            "not enough columns specified");
+
+        static_assert(
+            sizeof...(ColType)<=column_count,
+            "too many columns specified");
+
+        std::size_t count = 0;
+        while (count < max_rows && chop_next_row(err))
         {
-            if(*col_begin != quote)
+            detail::emplace_back_columns(cols...);
+            if (!convert_row(err, cols.back()...))
             {
-                ++col_begin;
+                detail::pop_back_columns(cols...);
+                if (skip_bad_row(err))
+                {
+                    continue;
+                }
+                format_row_error(err);
+                break;
             }
-            else
+            ++count;
+        }
+
+        return count;
+    }
+
+    template<class Err, class ...ColType>
+    bool convert_row(
+        Err &err,
+        ColType& ...cols)
+    {
+        if (!error_policy::checks_fields)
+        {
+            detail::parse_columns_unchecked<overflow_policy>(row, cols...);
+            return true;
+        }
+        return detail::parse_columns<overflow_policy>(row, column_names, err, cols...);
+    }
+
+    template<class Err>
+    void format_row_error(Err &err)
+    {
+        detail::set_error_location(err, in.get_truncated_file_name(), in.get_file_line());
+    }
+
+    /*
+     * Drops the current row if the error policy skips its error, in which
+     * case err is cleared. Returns whether the row was dropped.
+     */
+    template<class Err>
+    bool skip_bad_row(Err &err)
+    {
+        if (!error_policy::skips_bad_rows)
+        {
+            return false;
+        }
+
+        error::code c = detail::get_error_code(err);
+        if (!detail::is_row_error(c))
+        {
+            return false;
+        }
+
+        ++bad_row_counts[static_cast<std::size_t>(c)];
+        if (bad_row_lines.size() < error_policy::max_recorded_lines)
+        {
+            bad_row_lines.push_back(in.get_file_line());
+        }
+        detail::clear_error(err);
+        return true;
+    }
+
+    bool passes_filters() const
+    {
+        for (const auto &filter : filters)
+        {
+            if (!filter.second(row[filter.first]))
             {
-                do {
-                    ++col_begin;
-                    while(*col_begin != quote)
-                    {
-                        if(*col_begin == '\0')
-                        {
-                            err = std::make_shared<error::escaped_string_not_closed>();
-                            return nullptr;
-                        }
-                        ++col_begin;
-                    }
-                    ++col_begin;
-                } while(*col_begin == quote);
+                return false;
             }
         }
-        return col_begin;
+        return true;
     }
 
-    static void unescape(
-        char *&col_begin,
-        char *&col_end)
+    /*
+     * Reads the next line that is not a comment and passes the filters and
+     * splits it into row. Returns false at the end of the file or on a
+     * formatted error.
+     */
+    template<class Err>
+    bool chop_next_row(Err &err)
     {
-        if(col_end - col_begin >= 2)
+        for(;;)
         {
-            if(*col_begin == quote && *(col_end-1) == quote)
+            char *line;
+            do{
+                line = in.next_line(err);
+                if (err)
+                {
+                    format_row_error(err);
+                    return false;
+                }
+                if(!line)
+                {
+                    return false;
+                }
+            }while(comment_policy::is_comment(line));
+
+            if (!detail::parse_line<trim_policy, quote_policy>(
+                    line, row, col_order, in.get_column_end_index(), err, ignore_trailing))
             {
-                ++col_begin;
-                --col_end;
-                char *out = col_begin;
-                for(char*in = col_begin; in!=col_end; ++in)
+                if (skip_bad_row(err))
                 {
-                    if(*in == quote && (in+1) != col_end && *(in+1) == quote)
-                    {
-                        ++in;
-                    }
-                    *out = *in;
-                    ++out;
+                    continue;
                 }
-                col_end = out;
-                *col_end = '\0';
+                format_row_error(err);
+                return false;
+            }
+            if (passes_filters())
+            {
+                return true;
             }
         }
     }
 };
 
-class ignore_overflow
+////////////////////////////////////////////////////////////////////////////
+//                            DynamicCSVReader                            //
+////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The types to which DynamicCSVReader converts a column.
+ */
+enum class column_type
+{
+    text,
+    signed_integer,
+    unsigned_integer,
+    floating_point
+};
+
+struct column_spec
+{
+    std::string name;
+    column_type type;
+};
+
+template
+<
+    class trim_policy = trim_chars<' ', '\t'>,
+    class quote_policy = no_quote_escape<','>,
+    class overflow_policy = set_to_max_on_overflow,
+    class comment_policy = no_comment
+>
+class DynamicCSVReader;
+
+/*
+ * A field of a row read by DynamicCSVReader. The text is the trimmed and
+ * unescaped field in the buffer of the reader, or null if the column is
+ * missing in the file. The value has been converted according to the type
+ * of the column: get_signed_integer reads signed_integer columns,
+ * get_unsigned_integer unsigned_integer columns and get_floating_point
+ * floating_point columns. text columns only have get_text. Calling another
+ * accessor than the one of get_type fails an assert. The value is 0 for
+ * missing columns. Both are valid until the next row is read.
+ */
+class field_view
 {
 public:
-    template<class T>
-    static void on_overflow(T&){}
+    field_view()
+    {
+        value.unsigned_integer = 0;
+    }
 
-    template<class T>
-    static void on_underflow(T&){}
+    column_type get_type() const
+    {
+        return type;
+    }
+
+    bool is_missing() const
+    {
+        return text == nullptr;
+    }
+
+    const char *get_text() const
+    {
+        return text;
+    }
+
+    long long get_signed_integer() const
+    {
+        assert(type == column_type::signed_integer);
+        return value.signed_integer;
+    }
+
+    unsigned long long get_unsigned_integer() const
+    {
+        assert(type == column_type::unsigned_integer);
+        return value.unsigned_integer;
+    }
+
+    double get_floating_point() const
+    {
+        assert(type == column_type::floating_point);
+        return value.floating_point;
+    }
+
+private:
+    template<class, class, class, class> friend class DynamicCSVReader;
+
+    const char *text = nullptr;
+    column_type type = column_type::text;
+    union
+    {
+        long long signed_integer;
+        unsigned long long unsigned_integer;
+        double floating_point;
+    } value;
 };
 
-class set_to_max_on_overflow
+/*
+ * The fields of a row in the order of the columns.
+ */
+class field_span
 {
 public:
-    template<class T>
-    static void on_overflow(T &x)
+    field_span() = default;
+
+    field_span(const field_view *begin_, const field_view *end_):
+        first(begin_), last(end_){}
+
+    const field_view *begin() const
     {
-        /*
-         * Using (std::numeric_limits<T>::max) instead of std::numeric_limits<T>::max
-         * to make code including windows.h with its max macro happy
-         */
-        x = (std::numeric_limits<T>::max)();
+        return first;
+    }
+
+    const field_view *end() const
+    {
+        return last;
+    }
+
+    std::size_t size() const
+    {
+        return static_cast<std::size_t>(last - first);
+    }
+
+    bool empty() const
+    {
+        return first == last;
+    }
+
+    const field_view &operator[](std::size_t i) const
+    {
+        return first[i];
+    }
+
+private:
+    const field_view *first = nullptr;
+    const field_view *last = nullptr;
+};
+
+/*
+ * Reads the columns given at runtime. The rows are split into buffers that
+ * are sized when the header is set, so reading does not allocate apart
+ * from growing the line buffer and raising errors through a shared_ptr.
+ */
+template<class trim_policy, class quote_policy, class overflow_policy, class comment_policy>
+class DynamicCSVReader
+{
+private:
+    LineReader in;
+
+    std::vector<std::string> column_names;
+    std::vector<column_type> column_types;
+    detail::column_name_index column_index;
+    std::vector<int> col_order;
+    std::vector<char*> row;
+    std::vector<field_view> fields;
+    bool ignore_trailing = false;
+
+public:
+    DynamicCSVReader() = delete;
+    DynamicCSVReader(const DynamicCSVReader&) = delete;
+    DynamicCSVReader&operator=(const DynamicCSVReader&) = delete;
+
+    template<class ...Args>
+    explicit DynamicCSVReader(
+        std::shared_ptr<error::error> &err,
+        Args&&...args):
+            in(err, std::forward<Args>(args)...)
+    {
+        if (err)
+        {
+            err->format_error_message();
+        }
+    }
+
+    /*
+     * Reads the header line and arranges the columns like read_header of
+     * CSVReader does.
+     */
+    bool read_header(
+        std::shared_ptr<error::error> &err,
+        ignore_column ignore_policy,
+        const std::vector<column_spec> &columns)
+    {
+        char *line = next_header_line(err);
+        if (line == nullptr)
+        {
+            return false;
+        }
+
+        set_columns(columns);
+        bool success = detail::parse_header_line<trim_policy, quote_policy>(
+            line, col_order, column_index, ignore_policy, err);
+        ignore_trailing = (ignore_policy & ignore_trailing_columns) != 0;
+
+        if (!success)
+        {
+            err->set_file_name(get_truncated_file_name());
+            err->format_error_message();
+        }
+
+        return success;
+    }
+
+    /*
+     * Reads the header line and takes all its columns in the order of the
+     * file, converting every one to type. Use set_column_type afterwards
+     * to convert some of them differently.
+     */
+    bool read_header(
+        std::shared_ptr<error::error> &err,
+        column_type type)
+    {
+        char *line = next_header_line(err);
+        if (line == nullptr)
+        {
+            return false;
+        }
+
+        std::vector<column_spec> columns;
+        detail::ColumnEndIndex index;
+        while (line)
+        {
+            char *col_begin;
+            char *col_end;
+            if (!detail::chop_next_column<quote_policy>(line, col_begin, col_end, index, err))
+            {
+                err->set_file_name(get_truncated_file_name());
+                err->format_error_message();
+                return false;
+            }
+            trim_policy::trim(col_begin, col_end);
+            quote_policy::unescape(col_begin, col_end);
+            columns.push_back(column_spec{col_begin, type});
+        }
+
+        set_header(columns);
+        return true;
+    }
+
+    /*
+     * Sets the columns without reading any input. They must be in the
+     * order of the file.
+     */
+    void set_header(const std::vector<column_spec> &columns)
+    {
+        set_columns(columns);
+        column_index.set_all_read();
+        col_order.resize(column_names.size());
+        for (std::size_t i = 0; i < col_order.size(); ++i)
+        {
+            col_order[i] = static_cast<int>(i);
+        }
+        ignore_trailing = false;
+    }
+
+    bool has_column(const std::string &name) const
+    {
+        return column_index.has_column(name);
+    }
+
+    /*
+     * Returns the position of the column in the row, or -1 if it was not
+     * requested. A requested column that is missing in the file still has
+     * a position; its fields are missing.
+     */
+    int get_column_index(const std::string &name) const
+    {
+        return column_index.find(name);
+    }
+
+    std::size_t get_column_count() const
+    {
+        return column_names.size();
+    }
+
+    const std::string &get_column_name(std::size_t i) const
+    {
+        return column_names[i];
+    }
+
+    column_type get_column_type(std::size_t i) const
+    {
+        return column_types[i];
+    }
+
+    void set_column_type(std::size_t i, column_type type)
+    {
+        column_types[i] = type;
+        fields[i].type = type;
     }
 
-    template<class T>
-    static void on_underflow(T &x)
+    /*
+     * Reads the next row into the fields of the reader and lets r refer
+     * to them. Returns false at the end of the file or on error.
+     */
+    bool read_row(std::shared_ptr<error::error> &err, field_span &r)
     {
-        x = (std::numeric_limits<T>::min)();
+        return do_read_row(err, r);
     }
-};
 
-namespace detail
-{
+    bool read_row(error::status &err, field_span &r)
+    {
+        return do_read_row(err, r);
+    }
 
-template<class quote_policy>
-bool chop_next_column(
-    char *&line,
-    char *&col_begin,
-    char *&col_end,
-    std::shared_ptr<error::error> &err)
-{
-    if (err)
+    void set_file_name(const std::string &file_name)
     {
-        return false;
+        in.set_file_name(file_name);
     }
 
-    if (line == nullptr)
+    void set_file_name(const char *file_name)
     {
-        err = std::make_shared<error::internal_error>();
-        err->set_error("Internal error: line is null in chop_next_column");
-        return false;
+        in.set_file_name(file_name);
     }
 
-    col_begin = line;
+    const char *get_truncated_file_name() const
+    {
+        return in.get_truncated_file_name();
+    }
 
-    /* The col_begin + (... - col_begin) removes the constness */
-    col_end = col_begin + (quote_policy::find_next_column_end(col_begin, err) - col_begin);
+    void set_file_line(unsigned file_line)
+    {
+        in.set_file_line(file_line);
+    }
 
-    if (err)
+    unsigned get_file_line() const
     {
-        return false;
+        return in.get_file_line();
     }
 
-    if(*col_end == '\0')
+    void set_max_line_length(int max_line_length)
     {
-        line = nullptr;
+        in.set_max_line_length(max_line_length);
     }
-    else
+
+    int get_max_line_length() const
     {
-        *col_end = '\0';
-        line = col_end + 1;
+        return in.get_max_line_length();
     }
 
-    return true;
-}
+    int get_block_len() const
+    {
+        return in.get_block_len();
+    }
 
-template<class trim_policy, class quote_policy>
-bool parse_line(
-   char *line,
-   char **sorted_col,
-   const std::vector<int> &col_order,
-   std::shared_ptr<error::error> &err)
-{
-    if (err)
+    long long get_byte_offset() const
     {
-        return false;
+        return in.get_byte_offset();
     }
 
-    for (int i : col_order)
+private:
+    void set_columns(const std::vector<column_spec> &columns)
     {
-        if(line == nullptr)
+        column_names.clear();
+        column_types.clear();
+        for (const column_spec &c : columns)
         {
-            err = std::make_shared<::io::error::too_few_columns>();
-            return false;
+            column_names.push_back(c.name);
+            column_types.push_back(c.type);
         }
-
-        char *col_begin;
-        char *col_end;
-
-        if (!chop_next_column<quote_policy>(line, col_begin, col_end, err))
+        column_index.assign(column_names.data(), static_cast<unsigned>(column_names.size()));
+        row.assign(columns.size(), nullptr);
+        fields.assign(columns.size(), field_view());
+        for (std::size_t i = 0; i < columns.size(); ++i)
         {
-            return false;
+            fields[i].type = columns[i].type;
         }
+    }
 
-        if (i != -1)
+    char *next_header_line(std::shared_ptr<error::error> &err)
+    {
+        if (err)
         {
-            trim_policy::trim(col_begin, col_end);
-            quote_policy::unescape(col_begin, col_end);
-            sorted_col[i] = col_begin;
+            return nullptr;
         }
-    }
 
-    if(line != nullptr)
-    {
-        err = std::make_shared<::io::error::too_many_columns>();
-        return false;
-    }
+        char *line;
+        do
+        {
+            line = in.next_line(err);
+            if (err)
+            {
+                err->format_error_message();
+                return nullptr;
+            }
+            if(!line)
+            {
+                err = std::make_shared<error::header_missing>();
+                err->set_file_name(get_truncated_file_name());
+                err->format_error_message();
+                return nullptr;
+            }
+        }while(comment_policy::is_comment(line));
 
-    return true;
-}
+        return line;
+    }
 
-template<unsigned column_count, class trim_policy, class quote_policy>
-bool parse_header_line(
-    char *line,
-    std::vector<int> &col_order,
-    const std::string *col_name,
-    ignore_column ignore_policy,
-    std::shared_ptr<error::error> &err)
-{
-    if (err)
+    template<class Err>
+    void format_row_error(Err &err)
     {
-        return false;
+        detail::set_error_location(err, in.get_truncated_file_name(), in.get_file_line());
     }
 
-    col_order.clear();
-
-    bool found[column_count];
-    std::fill(found, found + column_count, false);
-    while(line)
+    template<class Err>
+    bool convert_field(Err &err, std::size_t i)
     {
-        char *col_begin;
-        char *col_end;
-        if (!chop_next_column<quote_policy>(line, col_begin, col_end, err))
-        {
-            return false;
-        }
-
-        trim_policy::trim(col_begin, col_end);
-        quote_policy::unescape(col_begin, col_end);
-
-        for(unsigned i = 0; i < column_count; ++i)
+        field_view &f = fields[i];
+        f.text = row[i];
+        if (row[i] == nullptr)
         {
-            if(col_begin == col_name[i])
+            switch (f.type)
             {
-                if(found[i])
-                {
-                    err = std::make_shared<error::duplicated_column_in_header>();
-                    err->set_column_name(col_begin);
-                    return false;
-                }
-
-                found[i] = true;
-                col_order.push_back(i);
-                col_begin = 0;
+            case column_type::signed_integer:
+                f.value.signed_integer = 0;
+                break;
+            case column_type::floating_point:
+                f.value.floating_point = 0;
+                break;
+            default:
+                f.value.unsigned_integer = 0;
                 break;
             }
+            return true;
         }
-        if(col_begin)
+
+        switch (column_types[i])
         {
-            if(ignore_policy & ::io::ignore_extra_column)
+        case column_type::text:
+            return true;
+        case column_type::signed_integer:
+            return detail::parse<overflow_policy>(row[i], f.value.signed_integer, err);
+        case column_type::unsigned_integer:
+            return detail::parse<overflow_policy>(row[i], f.value.unsigned_integer, err);
+        case column_type::floating_point:
+            return detail::parse<overflow_policy>(row[i], f.value.floating_point, err);
+        }
+        return true;
+    }
+
+    template<class Err>
+    bool do_read_row(Err &err, field_span &r)
+    {
+        if (err)
+        {
+            return false;
+        }
+
+        char *line;
+        do{
+            line = in.next_line(err);
+            if (err)
             {
-                col_order.push_back(-1);
+                format_row_error(err);
+                return false;
             }
-            else
+            if(!line)
             {
-                err = std::make_shared<error::extra_column_in_header>();
-                err->set_column_name(col_begin);
                 return false;
             }
+        }while(comment_policy::is_comment(line));
+
+        if (!detail::parse_line<trim_policy, quote_policy>(
+                line, row.data(), col_order, in.get_column_end_index(), err, ignore_trailing))
+        {
+            format_row_error(err);
+            return false;
         }
-    }
-    if(!(ignore_policy & ::io::ignore_missing_column))
-    {
-        for(unsigned i = 0; i < column_count; ++i)
+
+        for (std::size_t i = 0; i < fields.size(); ++i)
         {
-            if(!found[i])
+            if (!convert_field(err, i))
             {
-                err = std::make_shared<error::missing_column_in_header>();
-                err->set_column_name(col_name[i].c_str());
+                detail::set_error_column(err, column_names[i].c_str(), row[i]);
+                format_row_error(err);
                 return false;
             }
         }
+
+        r = field_span(fields.data(), fields.data() + fields.size());
+        return true;
     }
+};
 
-    return true;
-}
+////////////////////////////////////////////////////////////////////////////
+//                                  Join                                  //
+////////////////////////////////////////////////////////////////////////////
 
-template<class overflow_policy>
-bool parse(
-    char *col,
-    char &x,
-    std::shared_ptr<error::error> &err)
+static constexpr std::size_t default_join_memory_budget = std::size_t(1)<<28;
+
+namespace detail
 {
-    if (err)
-    {
-        return false;
-    }
 
-    if(!*col)
-    {
-        err = std::make_shared<error::invalid_single_character>();
-        return false;
-    }
+static constexpr unsigned join_partition_bits = 4;
+static constexpr unsigned join_partition_count = 1u<<join_partition_bits;
+static constexpr unsigned join_max_depth = 64/join_partition_bits - 1;
 
-    x = *col;
-    ++col;
+/*
+ * A row is stored as an array of column_count field pointers followed by
+ * the payload, which holds every present field as a 32 bit length and the
+ * null terminated bytes. Missing fields have the length all ones.
+ */
+static constexpr std::uint32_t missing_field_len = 0xFFFFFFFFu;
 
-    if(*col)
+static constexpr std::uint32_t no_join_row = 0xFFFFFFFFu;
+
+inline std::size_t raw_row_payload_len(char *const *row, unsigned column_count)
+{
+    std::size_t len = 0;
+    for (unsigned i = 0; i < column_count; ++i)
     {
-        err = std::make_shared<error::invalid_single_character>();
-        return false;
+        len += sizeof(std::uint32_t) + (row[i] != nullptr ? std::strlen(row[i]) + 1 : 0);
     }
+    return len;
+}
 
-    return true;
+inline void write_raw_row_payload(char *const *row, unsigned column_count, char *out)
+{
+    for (unsigned i = 0; i < column_count; ++i)
+    {
+        std::uint32_t len = missing_field_len;
+        if (row[i] != nullptr)
+        {
+            len = static_cast<std::uint32_t>(std::strlen(row[i]));
+        }
+        std::memcpy(out, &len, sizeof(len));
+        out += sizeof(len);
+        if (len != missing_field_len)
+        {
+            std::memcpy(out, row[i], len + 1);
+            out += len + 1;
+        }
+    }
 }
 
-template<class overflow_policy>
-bool parse(
-    char *col,
-    std::string &x,
-    std::shared_ptr<error::error> &err)
+inline void read_raw_row_payload(char *payload, unsigned column_count, char **row)
 {
-    (void)err;
-    x = col;
-    return true;
+    for (unsigned i = 0; i < column_count; ++i)
+    {
+        std::uint32_t len;
+        std::memcpy(&len, payload, sizeof(len));
+        payload += sizeof(len);
+        row[i] = nullptr;
+        if (len != missing_field_len)
+        {
+            row[i] = payload;
+            payload += len + 1;
+        }
+    }
 }
 
-template<class overflow_policy>
-bool parse(
-    char *col,
-    const char *&x,
-    std::shared_ptr<error::error> &err)
+inline std::uint64_t join_key_hash(char *const *row, const char *&key, std::uint32_t &key_len)
 {
-    (void)err;
-    x = col;
-    return true;
+    key = row[0] != nullptr ? row[0] : "";
+    key_len = static_cast<std::uint32_t>(std::strlen(key));
+    return hash_bytes(key, key_len);
 }
 
-template<class overflow_policy>
-bool parse(
-    char *col,
-    char *&x,
-    std::shared_ptr<error::error> &err)
+/*
+ * Appends a row to the partition file chosen by the hash bits of its key
+ * that belong to the given depth, which is created on demand. The record
+ * is the payload length followed by the payload.
+ */
+inline bool write_partitioned_row(
+    std::vector<unique_file> &partitions,
+    char *const *row,
+    unsigned column_count,
+    unsigned depth,
+    std::vector<char> &buffer)
 {
-    (void)err;
-    x = col;
-    return true;
+    const char *key;
+    std::uint32_t key_len;
+    std::uint64_t hash = join_key_hash(row, key, key_len);
+    const unsigned shift = 64 - join_partition_bits*(depth+1);
+    unique_file &file = partitions[(hash >> shift) & (join_partition_count-1)];
+    if (!file)
+    {
+        errno = 0;
+        file.reset(std::tmpfile());
+        if (!file)
+        {
+            return false;
+        }
+    }
+
+    std::uint64_t len = raw_row_payload_len(row, column_count);
+    buffer.resize(static_cast<std::size_t>(len));
+    write_raw_row_payload(row, column_count, buffer.data());
+    return std::fwrite(&len, sizeof(len), 1, file.get()) == 1 &&
+        std::fwrite(buffer.data(), 1, buffer.size(), file.get()) == buffer.size();
 }
 
-template<class overflow_policy, class T>
-bool parse_unsigned_integer(
-    const char *col,
-    T &x,
-    std::shared_ptr<error::error> &err)
+/*
+ * Reads the next row of a partition file into buffer and sets row to its
+ * fields. Returns false at the end of the file or on a read error.
+ */
+inline bool read_partitioned_row(
+    FILE *file,
+    unsigned column_count,
+    std::vector<char> &buffer,
+    char **row)
 {
-    if (err)
+    std::uint64_t len;
+    if (std::fread(&len, sizeof(len), 1, file) != 1)
     {
         return false;
     }
-
-    if(*col == '-')
+    buffer.resize(static_cast<std::size_t>(len));
+    if (std::fread(buffer.data(), 1, buffer.size(), file) != buffer.size())
     {
-        err = std::make_shared<error::integer_must_be_positive>();
         return false;
     }
+    read_raw_row_payload(buffer.data(), column_count, row);
+    return true;
+}
 
-    x = 0;
-    while(*col != '\0')
-    {
-        if('0' <= *col && *col <= '9')
-        {
-            T y = *col - '0';
-            if(x > ((std::numeric_limits<T>::max)()-y)/10)
-            {
-                overflow_policy::on_overflow(x);
-                return true;
-            }
-            x = 10*x+y;
+/*
+ * The build side of a hash join. Rows are copied into an arena and chained
+ * per key in the order in which they were added.
+ */
+template<unsigned column_count>
+class join_table
+{
+public:
+    void add(char *const *row)
+    {
+        const std::size_t pointers_len = column_count*sizeof(char*);
+        std::size_t payload_len = raw_row_payload_len(row, column_count);
+        payload_len = (payload_len + sizeof(char*) - 1) / sizeof(char*) * sizeof(char*);
+
+        char *memory = rows.allocate(pointers_len + payload_len);
+        char **copy = reinterpret_cast<char**>(memory);
+        write_raw_row_payload(row, column_count, memory + pointers_len);
+        read_raw_row_payload(memory + pointers_len, column_count, copy);
+
+        const char *key;
+        std::uint32_t key_len;
+        std::uint64_t hash = join_key_hash(row, key, key_len);
+        bool inserted;
+        key_table::slot &s = keys.find_or_insert(hash, key, key_len, inserted);
+
+        std::uint32_t index = static_cast<std::uint32_t>(row_list.size());
+        row_list.push_back(copy);
+        next.push_back(no_join_row);
+        if (inserted)
+        {
+            s.value = static_cast<std::uint32_t>(chains.size());
+            chains.push_back(std::make_pair(index, index));
         }
         else
         {
-            err = std::make_shared<error::no_digit>();
-            return false;
+            next[chains[s.value].second] = index;
+            chains[s.value].second = index;
         }
-        ++col;
     }
 
-    return true;
-}
-
-template<class overflow_policy> bool parse(char *col, unsigned char &x, std::shared_ptr<error::error> &err)
-    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, unsigned short &x, std::shared_ptr<error::error> &err)
-    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, unsigned int &x, std::shared_ptr<error::error> &err)
-    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, unsigned long &x, std::shared_ptr<error::error> &err)
-    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, unsigned long long &x, std::shared_ptr<error::error> &err)
-    {return parse_unsigned_integer<overflow_policy>(col, x, err);}
-
-template<class overflow_policy, class T>
-bool parse_signed_integer(
-    const char *col,
-    T &x,
-    std::shared_ptr<error::error> &err)
-{
-    if (err)
+    template<class Callback>
+    void probe(char *const *row, Callback &callback) const
     {
-        return false;
+        const char *key;
+        std::uint32_t key_len;
+        std::uint64_t hash = join_key_hash(row, key, key_len);
+        const key_table::slot *s = keys.find(hash, key, key_len);
+        if (s == nullptr)
+        {
+            return;
+        }
+        for (std::uint32_t i = chains[s->value].first; i != no_join_row; i = next[i])
+        {
+            callback(static_cast<char *const *>(row_list[i]), row);
+        }
     }
 
-    if(*col == '-')
+    bool spill(std::vector<unique_file> &partitions, unsigned depth, std::vector<char> &buffer) const
     {
-        ++col;
-        x = 0;
-        while(*col != '\0')
+        for (char **row : row_list)
         {
-            if('0' <= *col && *col <= '9')
-            {
-                T y = *col - '0';
-                if(x < ((std::numeric_limits<T>::min)()+y)/10)
-                {
-                    overflow_policy::on_underflow(x);
-                    return true;
-                }
-                x = 10*x-y;
-            }
-            else
+            if (!write_partitioned_row(partitions, row, column_count, depth, buffer))
             {
-                err = std::make_shared<error::no_digit>();
                 return false;
             }
-            ++col;
         }
         return true;
     }
-    else if(*col == '+')
-    {
-        ++col;
-    }
-
-    return parse_unsigned_integer<overflow_policy>(col, x, err);
-}
-
-template<class overflow_policy> bool parse(char *col, signed char &x, std::shared_ptr<error::error> &err)
-    {return parse_signed_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, signed short &x, std::shared_ptr<error::error> &err)
-    {return parse_signed_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, signed int &x, std::shared_ptr<error::error> &err)
-    {return parse_signed_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, signed long &x, std::shared_ptr<error::error> &err)
-    {return parse_signed_integer<overflow_policy>(col, x, err);}
-template<class overflow_policy> bool parse(char *col, signed long long &x, std::shared_ptr<error::error> &err)
-    {return parse_signed_integer<overflow_policy>(col, x, err);}
 
-template<class T>
-bool parse_float(
-    const char *col,
-    T &x,
-    std::shared_ptr<error::error> &err)
-{
-    if (err)
+    std::size_t key_count() const
     {
-        return false;
+        return keys.size();
     }
 
-    bool is_neg = false;
-    if(*col == '-')
+    std::size_t memory_usage() const
     {
-        is_neg = true;
-        ++col;
+        return keys.memory_usage() + rows.size() +
+            row_list.capacity()*sizeof(char**) + next.capacity()*sizeof(std::uint32_t) +
+            chains.capacity()*sizeof(chains[0]);
     }
-    else if(*col == '+')
+
+    void clear()
     {
-        ++col;
+        keys.clear();
+        rows.clear();
+        std::vector<char**>().swap(row_list);
+        std::vector<std::uint32_t>().swap(next);
+        std::vector<std::pair<std::uint32_t, std::uint32_t>>().swap(chains);
     }
 
-    x = 0;
-    while('0' <= *col && *col <= '9')
+private:
+    key_table keys;
+    arena rows;
+    std::vector<char**> row_list;
+    std::vector<std::uint32_t> next;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> chains;
+};
+
+/*
+ * Adds a build row to the table, or to the partitions of the given depth
+ * once the table has outgrown the budget. A table with a single key is
+ * not partitioned, as all its rows would end up in the same partition.
+ * Returns false if a partition file can not be written.
+ */
+template<unsigned column_count>
+bool add_build_row(
+    join_table<column_count> &table,
+    std::vector<unique_file> &partitions,
+    char *const *row,
+    std::size_t memory_budget,
+    unsigned depth,
+    std::vector<char> &buffer)
+{
+    if (!partitions.empty())
     {
-        int y = *col - '0';
-        x *= 10;
-        x += y;
-        ++col;
+        return write_partitioned_row(partitions, row, column_count, depth, buffer);
     }
 
-    if(*col == '.'|| *col == ',')
+    table.add(row);
+    if (table.memory_usage() > memory_budget && depth <= join_max_depth && table.key_count() > 1)
     {
-        ++col;
-        T pos = 1;
-        while('0' <= *col && *col <= '9')
+        partitions.resize(join_partition_count);
+        if (!table.spill(partitions, depth, buffer))
         {
-            pos /= 10;
-            int y = *col - '0';
-            ++col;
-            x += y*pos;
+            return false;
         }
+        table.clear();
     }
+    return true;
+}
 
-    if(*col == 'e' || *col == 'E')
+/*
+ * Joins the partitions of the given depth one at a time, skipping those
+ * that are empty on either side. A build partition that does not fit into
+ * the budget is partitioned again on the next hash bits together with its
+ * probe partition. partition_depth is raised to the number of partitioning
+ * levels used. Returns false if a partition file can not be read or
+ * written.
+ */
+template<unsigned build_count, unsigned probe_count, class Callback>
+bool join_partitions(
+    std::vector<unique_file> &build_partitions,
+    std::vector<unique_file> &probe_partitions,
+    unsigned depth,
+    join_table<build_count> &table,
+    Callback &callback,
+    std::size_t memory_budget,
+    std::vector<char> &buffer,
+    unsigned &partition_depth)
+{
+    partition_depth = std::max(partition_depth, depth+1);
+
+    std::vector<char> row_buffer;
+    char *build_row[build_count];
+    char *probe_row[probe_count];
+    for (unsigned i = 0; i < join_partition_count; ++i)
     {
-        ++col;
-        int e;
+        FILE *build_file = build_partitions[i].get();
+        FILE *probe_file = probe_partitions[i].get();
+        if (build_file == nullptr || probe_file == nullptr)
+        {
+            build_partitions[i].reset();
+            probe_partitions[i].reset();
+            continue;
+        }
+        std::rewind(build_file);
+        std::rewind(probe_file);
 
-        if (!parse_signed_integer<set_to_max_on_overflow>(col, e, err))
+        std::vector<unique_file> build_sub_partitions;
+        while (read_partitioned_row(build_file, build_count, row_buffer, build_row))
+        {
+            if (!add_build_row(table, build_sub_partitions, build_row, memory_budget, depth+1, buffer))
+            {
+                return false;
+            }
+        }
+        if (std::ferror(build_file) || !std::feof(build_file))
         {
             return false;
         }
 
-        if(e != 0)
+        if (build_sub_partitions.empty())
         {
-            T base;
-            if(e < 0)
+            while (read_partitioned_row(probe_file, probe_count, row_buffer, probe_row))
             {
-                base = T(0.1);
-                e = -e;
+                table.probe(probe_row, callback);
             }
-            else
+            if (std::ferror(probe_file) || !std::feof(probe_file))
             {
-                base = T(10);
+                return false;
             }
+            table.clear();
+            build_partitions[i].reset();
+            probe_partitions[i].reset();
+            continue;
+        }
 
-            while(e != 1)
+        std::vector<unique_file> probe_sub_partitions(join_partition_count);
+        while (read_partitioned_row(probe_file, probe_count, row_buffer, probe_row))
+        {
+            if (!write_partitioned_row(probe_sub_partitions, probe_row, probe_count, depth+1, buffer))
             {
-                if((e & 1) == 0)
-                {
-                    base = base*base;
-                    e >>= 1;
-                }
-                else
-                {
-                    x *= base;
-                    --e;
-                }
+                return false;
             }
-            x *= base;
+        }
+        if (std::ferror(probe_file) || !std::feof(probe_file))
+        {
+            return false;
+        }
+        build_partitions[i].reset();
+        probe_partitions[i].reset();
+
+        if (!join_partitions<build_count, probe_count>(
+                build_sub_partitions, probe_sub_partitions, depth+1,
+                table, callback, memory_budget, buffer, partition_depth))
+        {
+            return false;
         }
     }
-    else
+    return true;
+}
+
+} // end namespace detail
+
+/*
+ * Joins the rows of build and probe whose first columns, in the order of
+ * the column names, are equal after trimming and unescaping. For every
+ * pair callback(build_row, probe_row) is called with the arrays of the raw
+ * fields of both rows, which are null for missing columns and only valid
+ * during the call.
+ *
+ * The build side is read into a hash table first. If it exceeds
+ * memory_budget bytes, both sides are partitioned by the hash of the key
+ * into temporary files and joined one partition at a time. A build
+ * partition that still exceeds the budget is partitioned again on the
+ * next bits of the hash, unless it holds a single key. partition_depth is
+ * set to the number of partitioning levels used, 0 if everything fit into
+ * memory. The pairs arrive in the order of the probe rows, unless
+ * partitioning was necessary, in which case they are only ordered within
+ * a partition.
+ */
+template<
+    unsigned build_count, class ...BuildPolicies,
+    unsigned probe_count, class ...ProbePolicies,
+    class Callback>
+bool hash_join(
+    std::shared_ptr<error::error> &err,
+    CSVReader<build_count, BuildPolicies...> &build,
+    CSVReader<probe_count, ProbePolicies...> &probe,
+    Callback callback,
+    std::size_t memory_budget,
+    unsigned &partition_depth)
+{
+    partition_depth = 0;
+    if (err)
     {
-        if(*col != '\0')
+        return false;
+    }
+
+    detail::join_table<build_count> table;
+    std::vector<detail::unique_file> build_partitions;
+    std::vector<char> buffer;
+
+    while (char *const *row = build.read_raw_row(err))
+    {
+        if (!detail::add_build_row(table, build_partitions, row, memory_budget, 0, buffer))
         {
-            err = std::make_shared<error::no_digit>();
-            return false;
+            return detail::temporary_file_failed(err);
         }
     }
+    if (err)
+    {
+        return false;
+    }
 
-    if(is_neg)
+    if (build_partitions.empty())
     {
-        x = -x;
+        while (char *const *row = probe.read_raw_row(err))
+        {
+            table.probe(row, callback);
+        }
+        return !err;
+    }
+
+    std::vector<detail::unique_file> probe_partitions(detail::join_partition_count);
+    while (char *const *row = probe.read_raw_row(err))
+    {
+        if (!detail::write_partitioned_row(probe_partitions, row, probe_count, 0, buffer))
+        {
+            return detail::temporary_file_failed(err);
+        }
+    }
+    if (err)
+    {
+        return false;
     }
 
+    if (!detail::join_partitions<build_count, probe_count>(
+            build_partitions, probe_partitions, 0,
+            table, callback, memory_budget, buffer, partition_depth))
+    {
+        return detail::temporary_file_failed(err);
+    }
     return true;
 }
 
-template<class overflow_policy> bool parse(char *col, float &x, std::shared_ptr<error::error> &err) { return parse_float(col, x, err); }
-template<class overflow_policy> bool parse(char *col, double &x, std::shared_ptr<error::error> &err) { return parse_float(col, x, err); }
-template<class overflow_policy> bool parse(char *col, long double &x, std::shared_ptr<error::error> &err) { return parse_float(col, x, err); }
-
-template<class overflow_policy, class T>
-void parse(
-    char *col,
-    T &x,
-    std::shared_ptr<error::error> &err)
+template<
+    unsigned build_count, class ...BuildPolicies,
+    unsigned probe_count, class ...ProbePolicies,
+    class Callback>
+bool hash_join(
+    std::shared_ptr<error::error> &err,
+    CSVReader<build_count, BuildPolicies...> &build,
+    CSVReader<probe_count, ProbePolicies...> &probe,
+    Callback callback,
+    std::size_t memory_budget = default_join_memory_budget)
 {
-    /* Mute unused variable compiler warning */
-    (void)col;
-    (void)x;
-    (void)err;
-
-    /*
-     * GCC evalutes "false" when reading the template and
-     * "sizeof(T)!=sizeof(T)" only when instantiating it. This is why
-     * this strange construct is used.
-     */
-    static_assert(
-        sizeof(T)!=sizeof(T),
-        "Can not parse this type. Only buildin integrals, floats, char, char*, "
-        "const char* and std::string are supported");
+    unsigned partition_depth;
+    return hash_join(err, build, probe, callback, memory_budget, partition_depth);
 }
 
 
-} // end namespace detail
+#ifdef CSV_IO_THREAD
 
 ////////////////////////////////////////////////////////////////////////////
-//                               CsvReader                                //
+//                          ParallelCSVReader                             //
 ////////////////////////////////////////////////////////////////////////////
 
+using row_order = unsigned int;
+static constexpr row_order in_file_order = 0;
+static constexpr row_order any_order = 1;
+
+namespace detail
+{
+
 /*
- * Time to put it all together.
+ * Splits off the line starting at pos, null terminates it and advances pos
+ * behind it. end must point to writable memory.
+ */
+inline char *split_next_line(char *&pos, char *end)
+{
+    char *line = pos;
+    char *line_end = static_cast<char*>(std::memchr(pos, '\n', end - pos));
+    if (line_end == nullptr)
+    {
+        line_end = end;
+    }
+
+    *line_end = '\0';
+    if(line_end != line && *(line_end-1) == '\r')
+    {
+        *(line_end-1) = '\0';
+    }
+
+    pos = line_end + 1;
+    return line;
+}
+
+/*
+ * Reads the lines that start in [begin, end) of the file into data. Lines
+ * that start in front of begin are skipped and the line that starts last
+ * is completed past end. data_begin is the offset of the first line that
+ * may be returned (the line after the header). Afterwards the lines are in
+ * [data.data() + first, data.data() + data.size() - 1), followed by one
+ * spare byte for the terminator of a last line without newline.
  */
+inline bool load_lines(
+    FILE *file,
+    long long data_begin,
+    long long begin,
+    long long end,
+    std::vector<char> &data,
+    std::size_t &first)
+{
+    long long read_begin = begin > data_begin ? begin - 1 : data_begin;
+    data.resize(static_cast<std::size_t>(end - read_begin));
+    if (!seek_file(file, read_begin))
+    {
+        return false;
+    }
+    data.resize(std::fread(data.data(), 1, data.size(), file));
+
+    first = 0;
+    if (begin > data_begin)
+    {
+        /* data[0] is the byte in front of begin */
+        void *nl = std::memchr(data.data(), '\n', data.size());
+        if (nl == nullptr)
+        {
+            /* A single line spans the whole range and belongs to an earlier one */
+            data.clear();
+            data.push_back('\0');
+            return true;
+        }
+        first = static_cast<char*>(nl) - data.data() + 1;
+    }
+
+    if (first < data.size() && data.back() != '\n')
+    {
+        const std::size_t step = 1<<16;
+        for (;;)
+        {
+            std::size_t old_size = data.size();
+            data.resize(old_size + step);
+            std::size_t n = std::fread(data.data() + old_size, 1, step, file);
+            data.resize(old_size + n);
 
+            void *nl = std::memchr(data.data() + old_size, '\n', n);
+            if (nl != nullptr)
+            {
+                data.resize(static_cast<char*>(nl) - data.data() + 1);
+                break;
+            }
+            if (n < step)
+            {
+                break;
+            }
+        }
+    }
+
+    data.push_back('\0');
+    return true;
+}
+
+} // end namespace detail
+
+/*
+ * Parses one file with several threads. The file is cut into chunks of
+ * roughly chunk_len bytes, every chunk is moved to the next line start and
+ * parsed independently with the same policies as CSVReader. The rows are
+ * then handed to a callback on the calling thread, either in file order
+ * or in the order in which the chunks complete.
+ */
 template
 <
     unsigned column_count,
@@ -1425,68 +8319,213 @@ template
     class overflow_policy = set_to_max_on_overflow,
     class comment_policy = no_comment
 >
-class CSVReader
+class ParallelCSVReader
 {
+public:
+    static constexpr long long default_chunk_len = 1<<22;
+
 private:
-    LineReader in;
+    std::string file_name;
+    unsigned thread_count;
+    long long chunk_len;
+    long long file_size;
+    long long data_begin;
+    unsigned header_line_count;
 
-    char*row[column_count];
     std::string column_names[column_count];
+    detail::column_name_index column_index;
     std::vector<int> col_order;
-    bool valid;
+    bool ignore_trailing = false;
+
+    template<class ...ColNames>
+    void set_column_names(
+        std::string s,
+        ColNames... cols)
+    {
+        column_names[column_count - sizeof...(ColNames)-1] = std::move(s);
+        set_column_names(std::forward<ColNames>(cols)...);
+    }
+
+    void set_column_names()
+    {
+        column_index.assign(column_names, column_count);
+    }
+
+    void set_error_location(
+        std::shared_ptr<error::error> &err,
+        unsigned file_line)
+    {
+        err->set_file_name(file_name);
+        err->set_file_line(file_line);
+        err->format_error_message();
+    }
+
+    template<class Row, std::size_t ...I>
+    static bool parse_row(
+        char *const *row,
+        const std::string *names,
+        std::shared_ptr<error::error> &err,
+        Row &r,
+        detail::index_sequence<I...>)
+    {
+        return detail::parse_columns<overflow_policy>(row, names, err, std::get<I>(r)...);
+    }
+
+    template<class Aggregates, std::size_t ...I>
+    static bool accumulate_row(
+        char *const *row,
+        const std::string *names,
+        std::shared_ptr<error::error> &err,
+        Aggregates &a,
+        detail::index_sequence<I...>)
+    {
+        return detail::accumulate_columns<overflow_policy>(row, names, err, std::get<I>(a)...);
+    }
+
+    template<class Aggregates, class ...ColType, std::size_t ...I>
+    static void merge_aggregates(
+        const Aggregates &from,
+        detail::index_sequence<I...>,
+        column_aggregate<ColType>& ...to)
+    {
+        int expand[] = {(to.merge(std::get<I>(from)), 0)...};
+        (void)expand;
+    }
 
-    template<class ...ColNames>
-    void set_column_names(
-        std::string s,
-        ColNames... cols)
+    template<class Callback, class Row, std::size_t ...I>
+    static void deliver_row(
+        Callback &callback,
+        Row &r,
+        detail::index_sequence<I...>)
     {
-        column_names[column_count - sizeof...(ColNames)-1] = std::move(s);
-        set_column_names(std::forward<ColNames>(cols)...);
+        callback(std::get<I>(r)...);
     }
 
-    void set_column_names(){}
+    /*
+     * Loads the lines of the chunk with the given index into data, chops
+     * every line that is not a comment into row and calls
+     * handle_row(row, err). Stops at the first line that can not be
+     * chopped or for which handle_row returns false. line_count is the
+     * number of lines consumed, including the broken one.
+     */
+    template<class RowHandler>
+    bool parse_chunk(
+        FILE *file,
+        long long index,
+        std::vector<char> &data,
+        char **row,
+        unsigned &line_count,
+        std::shared_ptr<error::error> &err,
+        RowHandler handle_row)
+    {
+        line_count = 0;
+        long long begin = data_begin + index*chunk_len;
+        long long end = std::min(begin + chunk_len, file_size);
+        std::size_t first = 0;
+        if (file == nullptr || !detail::load_lines(file, data_begin, begin, end, data, first))
+        {
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(errno);
+            return false;
+        }
+
+        char *pos = data.data() + first;
+        char *data_end = data.data() + data.size() - 1;
+        detail::ColumnEndIndex column_end_index;
+        while (pos < data_end)
+        {
+            char *line = detail::split_next_line(pos, data_end);
+            ++line_count;
+            if (comment_policy::is_comment(line))
+            {
+                continue;
+            }
+
+            if (!detail::parse_line<trim_policy, quote_policy>(line, row, col_order, column_end_index, err, ignore_trailing) ||
+                !handle_row(row, err))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
 
 public:
-    CSVReader() = delete;
-    CSVReader(const CSVReader&) = delete;
-    CSVReader&operator=(const CSVReader&);
+    ParallelCSVReader() = delete;
+    ParallelCSVReader(const ParallelCSVReader&) = delete;
+    ParallelCSVReader&operator=(const ParallelCSVReader&) = delete;
 
-    template<class ...Args>
-    explicit CSVReader(
+    /*
+     * thread_count 0 uses one thread per hardware thread.
+     */
+    ParallelCSVReader(
         std::shared_ptr<error::error> &err,
-        Args&&...args):
-            in(err, std::forward<Args>(args)...)
+        const std::string &file_name_,
+        unsigned thread_count_ = 0,
+        long long chunk_len_ = default_chunk_len):
+            file_name(file_name_.substr(0, error::max_file_name_length)),
+            thread_count(thread_count_),
+            chunk_len(chunk_len_),
+            file_size(0),
+            data_begin(0),
+            header_line_count(0)
     {
-        if (err)
+        if (thread_count == 0)
         {
-            err->format_error_message();
-            return;
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (chunk_len <= 0)
+        {
+            chunk_len = default_chunk_len;
         }
 
-        std::fill(row, row+column_count, nullptr);
         col_order.resize(column_count);
-
         for(unsigned i=0; i<column_count; ++i)
         {
             col_order[i] = i;
+            column_names[i] = "col"+std::to_string(i+1);
         }
+        column_index.assign(column_names, column_count);
+        column_index.set_all_read();
 
-        for(unsigned i=1; i<=column_count; ++i)
+        if (err)
         {
-            column_names[i-1] = "col"+std::to_string(i);
+            return;
         }
-    }
 
-    char *next_line(std::shared_ptr<error::error> &err)
-    {
-        if (err)
+        FILE *file = std::fopen(file_name_.c_str(), "rb");
+        if (file == nullptr)
         {
-            return nullptr;
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(file_name);
+            err->format_error_message();
+            return;
         }
 
-        return in.next_line(err);
+        file_size = detail::get_file_size(file);
+
+        /* Ignore UTF-8 BOM */
+        char bom[3];
+        if (file_size >= 3 && detail::seek_file(file, 0) &&
+            std::fread(bom, 1, 3, file) == 3 &&
+            bom[0] == '\xEF' && bom[1] == '\xBB' && bom[2] == '\xBF')
+        {
+            data_begin = 3;
+        }
+
+        std::fclose(file);
     }
 
+    ParallelCSVReader(
+        std::shared_ptr<error::error> &err,
+        const char *file_name_,
+        unsigned thread_count_ = 0,
+        long long chunk_len_ = default_chunk_len):
+            ParallelCSVReader(err, std::string(file_name_), thread_count_, chunk_len_)
+    {}
+
     template<class ...ColNames>
     bool read_header(
         std::shared_ptr<error::error> &err,
@@ -1502,140 +8541,316 @@ public:
         }
 
         set_column_names(std::forward<ColNames>(cols)...);
-        char *line;
-        do
+
+        FILE *file = std::fopen(file_name.c_str(), "rb");
+        if (file == nullptr)
         {
-            line = in.next_line(err);
-            if (err)
+            int x = errno;
+            err = std::make_shared<error::cannot_open_file>();
+            err->set_errno(x);
+            err->set_file_name(file_name);
+            err->format_error_message();
+            return false;
+        }
+
+        /*
+         * Load lines until the header is found. The first range is grown
+         * as long as it ends in the middle of the header.
+         */
+        std::vector<char> data;
+        std::size_t first;
+        long long header_begin = data_begin;
+        char *line = nullptr;
+        unsigned line_count = 0;
+        while (line == nullptr && header_begin < file_size)
+        {
+            bool loaded = detail::load_lines(
+                file, header_begin, header_begin, header_begin + 1, data, first);
+            if (!loaded || first + 1 >= data.size())
             {
-                return false;
+                break;
             }
-            if(!line)
+
+            char *pos = data.data() + first;
+            char *end = data.data() + data.size() - 1;
+            char *candidate = detail::split_next_line(pos, end);
+            ++line_count;
+            header_begin += pos - (data.data() + first);
+            if (header_begin > file_size)
             {
-                err = std::make_shared<error::header_missing>();
-                err->set_file_name(get_truncated_file_name());
-                err->format_error_message();
-                return false;
+                header_begin = file_size;
             }
-        }while(comment_policy::is_comment(line));
+            if (!comment_policy::is_comment(candidate))
+            {
+                line = candidate;
+            }
+        }
+        std::fclose(file);
 
-        bool success = detail::parse_header_line<column_count, trim_policy, quote_policy>(
-            line, col_order, column_names, ignore_policy, err);
+        if (line == nullptr)
+        {
+            err = std::make_shared<error::header_missing>();
+            err->set_file_name(file_name);
+            err->format_error_message();
+            return false;
+        }
 
-        if (!success)
+        if (!detail::parse_header_line<trim_policy, quote_policy>(
+                line, col_order, column_index, ignore_policy, err))
         {
-            err->set_file_name(get_truncated_file_name());
+            err->set_file_name(file_name);
             err->format_error_message();
+            return false;
         }
+        ignore_trailing = (ignore_policy & ignore_trailing_columns) != 0;
 
-        return success;
+        data_begin = header_begin;
+        header_line_count = line_count;
+        return true;
     }
 
     template<class ...ColNames>
     bool set_header(ColNames...cols)
     {
-        static_assert(
-            sizeof...(ColNames)>=column_count,
-            "not enough column names specified");
-
-        static_assert(
-            sizeof...(ColNames)<=column_count,
-            "too many column names specified");
+        static_assert(sizeof...(ColNames)>=column_count, "not enough column names specified");
+        static_assert(sizeof...(ColNames)<=column_count, "too many column names specified");
 
         set_column_names(std::forward<ColNames>(cols)...);
-        std::fill(row, row+column_count, nullptr);
+        column_index.set_all_read();
         col_order.resize(column_count);
         for(unsigned i=0; i<column_count; ++i)
         {
             col_order[i] = i;
         }
+        ignore_trailing = false;
 
         return true;
     }
 
     bool has_column(const std::string &name) const
     {
-        return col_order.end() != std::find(
-                col_order.begin(), col_order.end(),
-                        std::find(std::begin(column_names), std::end(column_names), name)
-                - std::begin(column_names));
-    }
-
-    void set_file_name(const std::string &file_name)
-    {
-        in.set_file_name(file_name);
-    }
-
-    void set_file_name(const char *file_name)
-    {
-        in.set_file_name(file_name);
+        return column_index.has_column(name);
     }
 
-
     const char *get_truncated_file_name() const
     {
-        return in.get_truncated_file_name();
+        return file_name.c_str();
     }
 
-    void set_file_line(unsigned file_line)
+    /*
+     * Parses all rows and calls callback(col1, col2, ...) for each of them
+     * on the calling thread. The column types must be given explicitly,
+     * f.e. for_each_row<int, std::string>(err, callback). char* columns
+     * point into the chunk buffer and are only valid during the call.
+     *
+     * Parsing stops at the first error, which is reported with its line
+     * number in err. In file order all rows in front of the broken line have
+     * been handed to the callback. In any order some rows behind it may have
+     * been handed over as well.
+     */
+    template<class ...ColType, class Callback>
+    bool for_each_row(
+        std::shared_ptr<error::error> &err,
+        Callback callback,
+        row_order order = in_file_order)
     {
-        in.set_file_line(file_line);
-    }
+        static_assert(
+            sizeof...(ColType)>=column_count,
+            "not enough columns specified");
 
-    unsigned get_file_line() const
-    {
-        return in.get_file_line();
-    }
+        static_assert(
+            sizeof...(ColType)<=column_count,
+            "too many columns specified");
 
-private:
-    bool parse_helper(
-        std::size_t,
-        std::shared_ptr<error::error> &err)
-    {
         if (err)
         {
-            err->format_error_message();
             return false;
         }
 
-        return true;
-    }
+        using row_type = std::tuple<typename std::decay<ColType>::type...>;
+        using indices = typename detail::make_index_sequence<sizeof...(ColType)>::type;
 
-    template<class T, class ...ColType>
-    bool parse_helper(
-        std::size_t r,
-        std::shared_ptr<error::error> &err,
-        T &t,
-        ColType&...cols)
-    {
-        if (err)
+        struct chunk
         {
-            return false;
+            std::vector<char> data;
+            std::vector<row_type> rows;
+            unsigned line_count = 0;
+            unsigned error_line = 0;
+            std::shared_ptr<error::error> err;
+        };
+
+        const long long chunk_total = (file_size - data_begin + chunk_len - 1) / chunk_len;
+        const long long window = 2*static_cast<long long>(thread_count);
+
+        std::mutex lock;
+        std::condition_variable chunk_done;
+        std::condition_variable window_moved;
+        bool stop = false;
+        long long next_claim = 0;
+        long long lowest_pending = 0;
+        std::vector<std::unique_ptr<chunk>> slots(static_cast<std::size_t>(window));
+        std::vector<unsigned> line_counts;
+        std::vector<bool> completed;
+        line_counts.resize(static_cast<std::size_t>(chunk_total));
+        completed.resize(static_cast<std::size_t>(chunk_total));
+
+        auto work = [&]()
+        {
+            FILE *file = std::fopen(file_name.c_str(), "rb");
+            char *row[column_count];
+            std::fill(row, row+column_count, nullptr);
+
+            for(;;)
+            {
+                long long index;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    window_moved.wait(
+                        guard,
+                        [&]
+                        {
+                            return stop || next_claim >= chunk_total ||
+                                next_claim < lowest_pending + window;
+                        });
+                    if (stop || next_claim >= chunk_total)
+                    {
+                        break;
+                    }
+                    index = next_claim++;
+                }
+
+                std::unique_ptr<chunk> c(new chunk);
+                std::vector<row_type> &rows = c->rows;
+                if (!parse_chunk(
+                        file, index, c->data, row, c->line_count, c->err,
+                        [&](char *const *r, std::shared_ptr<error::error> &row_err)
+                        {
+                            rows.emplace_back();
+                            if (!parse_row(r, column_names, row_err, rows.back(), indices()))
+                            {
+                                rows.pop_back();
+                                return false;
+                            }
+                            return true;
+                        }))
+                {
+                    c->error_line = c->line_count;
+                }
+
+                std::unique_lock<std::mutex> guard(lock);
+                line_counts[index] = c->line_count;
+                completed[index] = true;
+                slots[index % window] = std::move(c);
+                chunk_done.notify_all();
+            }
+
+            if (file != nullptr)
+            {
+                std::fclose(file);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < thread_count && i < chunk_total; ++i)
+        {
+            workers.emplace_back(work);
         }
 
-        if(row[r])
+        std::vector<bool> delivered;
+        delivered.resize(static_cast<std::size_t>(chunk_total));
+        bool success = true;
+
+        for (long long delivered_count = 0; delivered_count < chunk_total; ++delivered_count)
         {
-            if (!::io::detail::parse<overflow_policy>(row[r], t, err))
+            std::unique_ptr<chunk> c;
+            long long index = 0;
             {
-                err->set_column_content(row[r]);
-                err->set_column_name(column_names[r].c_str());
-                return false;
+                std::unique_lock<std::mutex> guard(lock);
+                chunk_done.wait(
+                    guard,
+                    [&]
+                    {
+                        for (index = lowest_pending; index < next_claim; ++index)
+                        {
+                            if (completed[index] && !delivered[index])
+                            {
+                                return true;
+                            }
+                            if (order == in_file_order)
+                            {
+                                return false;
+                            }
+                        }
+                        return false;
+                    });
+                c = std::move(slots[index % window]);
+            }
+
+            for (row_type &r : c->rows)
+            {
+                deliver_row(callback, r, indices());
+            }
+
+            if (c->err)
+            {
+                /*
+                 * The line number depends on all chunks in front, which
+                 * have all been claimed already.
+                 */
+                std::unique_lock<std::mutex> guard(lock);
+                chunk_done.wait(
+                    guard,
+                    [&]
+                    {
+                        return std::find(completed.begin(), completed.begin() + index, false)
+                            == completed.begin() + index;
+                    });
+
+                unsigned file_line = header_line_count + c->error_line;
+                for (long long i = 0; i < index; ++i)
+                {
+                    file_line += line_counts[i];
+                }
+
+                err = c->err;
+                set_error_location(err, file_line);
+                success = false;
+                break;
+            }
+
+            std::unique_lock<std::mutex> guard(lock);
+            delivered[index] = true;
+            while (lowest_pending < chunk_total && delivered[lowest_pending])
+            {
+                ++lowest_pending;
             }
+            window_moved.notify_all();
+        }
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            stop = true;
+            window_moved.notify_all();
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
         }
-        return parse_helper(r+1, err, cols...);
+
+        return success;
     }
 
-public:
+    /*
+     * Adds every column to its aggregate like CSVReader::aggregate. Each
+     * chunk is aggregated on its own and the partial results are merged in
+     * file order, so floating point sums do not depend on the scheduling.
+     * On error the aggregates contain the rows in front of the broken line.
+     */
     template<class ...ColType>
-    bool read_row(
+    bool aggregate(
         std::shared_ptr<error::error> &err,
-        ColType& ...cols)
+        column_aggregate<ColType>& ...aggregates)
     {
-        if (err)
-        {
-            return false;
-        }
-
         static_assert(
             sizeof...(ColType)>=column_count,
             "not enough columns specified");
@@ -1644,36 +8859,93 @@ public:
             sizeof...(ColType)<=column_count,
             "too many columns specified");
 
-        char *line;
-        do{
-            line = in.next_line(err);
-            if(!line)
+        if (err)
+        {
+            return false;
+        }
+
+        using partial_type = std::tuple<column_aggregate<ColType>...>;
+        using indices = typename detail::make_index_sequence<sizeof...(ColType)>::type;
+
+        const long long chunk_total = (file_size - data_begin + chunk_len - 1) / chunk_len;
+
+        std::mutex lock;
+        long long next_claim = 0;
+        long long error_index = chunk_total;
+        unsigned error_line = 0;
+        std::shared_ptr<error::error> chunk_err;
+        std::vector<partial_type> partials(static_cast<std::size_t>(chunk_total));
+        std::vector<unsigned> line_counts(static_cast<std::size_t>(chunk_total));
+
+        auto work = [&]()
+        {
+            FILE *file = std::fopen(file_name.c_str(), "rb");
+            char *row[column_count];
+            std::fill(row, row+column_count, nullptr);
+            std::vector<char> data;
+
+            for(;;)
             {
-                return false;
+                long long index;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    if (next_claim >= chunk_total || next_claim > error_index)
+                    {
+                        break;
+                    }
+                    index = next_claim++;
+                }
+
+                partial_type &partial = partials[index];
+                std::shared_ptr<error::error> line_err;
+                unsigned line_count = 0;
+                parse_chunk(
+                    file, index, data, row, line_count, line_err,
+                    [&](char *const *r, std::shared_ptr<error::error> &row_err)
+                    {
+                        return accumulate_row(r, column_names, row_err, partial, indices());
+                    });
+
+                std::unique_lock<std::mutex> guard(lock);
+                line_counts[index] = line_count;
+                if (line_err && index < error_index)
+                {
+                    error_index = index;
+                    error_line = line_count;
+                    chunk_err = line_err;
+                }
             }
-            if (err)
+
+            if (file != nullptr)
             {
-                err->set_file_name(in.get_truncated_file_name());
-                err->set_file_line(in.get_file_line());
-                err->format_error_message();
-                return false;
+                std::fclose(file);
             }
-        }while(comment_policy::is_comment(line));
+        };
 
-        if (!detail::parse_line<trim_policy, quote_policy>(line, row, col_order, err))
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < thread_count && i < chunk_total; ++i)
         {
-            err->set_file_name(in.get_truncated_file_name());
-            err->set_file_line(in.get_file_line());
-            err->format_error_message();
-            return false;
+            workers.emplace_back(work);
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
         }
 
-        parse_helper(0, err, cols...);
-        if (err)
+        for (long long i = 0; i < chunk_total && i <= error_index; ++i)
         {
-            err->set_file_name(in.get_truncated_file_name());
-            err->set_file_line(in.get_file_line());
-            err->format_error_message();
+            merge_aggregates(partials[i], indices(), aggregates...);
+        }
+
+        if (chunk_err)
+        {
+            unsigned file_line = header_line_count + error_line;
+            for (long long i = 0; i < error_index; ++i)
+            {
+                file_line += line_counts[i];
+            }
+            err = chunk_err;
+            set_error_location(err, file_line);
             return false;
         }
 
@@ -1681,6 +8953,8 @@ public:
     }
 };
 
+#endif
+
 } // end namespace io
 
 #endif // CSV_H
\ No newline at end of file
@@ -1,7 +1,49 @@
 #include "csv.h"
 
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+#include <unistd.h>
+
 #include <gtest/gtest.h>
 
+/*
+ * A file name in /tmp that no other test uses, not even one running at the
+ * same time in the other test binary. The file is removed at the end of the
+ * scope.
+ */
+class temp_file
+{
+public:
+    temp_file()
+    {
+        char name[] = "/tmp/csv_test_XXXXXX";
+        int fd = mkstemp(name);
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        file_name = name;
+    }
+
+    temp_file(const temp_file&) = delete;
+    temp_file&operator=(const temp_file&) = delete;
+
+    ~temp_file()
+    {
+        std::remove(file_name.c_str());
+    }
+
+    const char *c_str() const
+    {
+        return file_name.c_str();
+    }
+
+private:
+    std::string file_name;
+};
+
 TEST(csv, nominal)
 {
     std::shared_ptr<io::error::error> err;
@@ -173,10 +215,1436 @@ TEST(csv, no_digit)
 
 TEST(csv, integer_overflow)
 {
-    // TODO
+    std::string data =
+        "a,b,c\n"
+        "255,4294967295,18446744073709551615\n"
+        "256,4294967296,18446744073709551616\n"
+        "1000,99999999999,000000000000000000000000012345678901234567\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b", "c"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    unsigned char a;
+    unsigned b;
+    unsigned long long c;
+    ASSERT_TRUE(reader.read_row(err, a,b,c));
+    ASSERT_EQ(a, 255);
+    ASSERT_EQ(b, 4294967295u);
+    ASSERT_EQ(c, 18446744073709551615u);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        ASSERT_TRUE(reader.read_row(err, a,b,c));
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_EQ(a, 255);
+        ASSERT_EQ(b, 4294967295u);
+        ASSERT_EQ(c, i == 0 ? 18446744073709551615u : 12345678901234567u);
+    }
 }
 
 TEST(csv, integer_underflow)
 {
-    // TODO
-}
\ No newline at end of file
+    std::string data =
+        "a,b,c\n"
+        "-128,-2147483648,-9223372036854775808\n"
+        "-129,-2147483649,-9223372036854775809\n"
+        "-12345678,+2147483647,-00000000000000000000012345678901234567\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b", "c"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    signed char a;
+    int b;
+    long long c;
+    for (int i = 0; i < 2; ++i)
+    {
+        ASSERT_TRUE(reader.read_row(err, a,b,c));
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_EQ(a, -128);
+        ASSERT_EQ(b, (std::numeric_limits<int>::min)());
+        ASSERT_EQ(c, (std::numeric_limits<long long>::min)());
+    }
+
+    ASSERT_TRUE(reader.read_row(err, a,b,c));
+    ASSERT_EQ(a, -128);
+    ASSERT_EQ(b, 2147483647);
+    ASSERT_EQ(c, -12345678901234567);
+}
+
+TEST(csv, memory_mapped)
+{
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "6.csv", io::memory_map);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a,b;
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a,1);
+    ASSERT_EQ(b,2);
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a,3);
+    ASSERT_EQ(b,4);
+    ASSERT_FALSE(reader.read_row(err, a,b));
+    ASSERT_TRUE(err);
+
+    ASSERT_EQ(
+        err->get_error(),
+        "Too few columns in line 4 in file \"6.csv\"");
+
+    /* The terminators must not have been written back to the file */
+    std::shared_ptr<io::error::error> err2;
+    io::LineReader lines(err2, "6.csv");
+    ASSERT_FALSE(err2) << err2->get_error();
+    ASSERT_STREQ(lines.next_line(err2), "a,b");
+    ASSERT_STREQ(lines.next_line(err2), "1,2");
+}
+
+TEST(csv, memory_mapped_cannot_open_file)
+{
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<4> reader(err, "-1.csv", io::memory_map);
+    ASSERT_TRUE(err);
+
+    ASSERT_EQ(
+        err->get_error(),
+        "Can not open file \"-1.csv\" because \"No such file or directory\".");
+}
+
+TEST(csv, line_ends_across_scan_windows)
+{
+    /*
+     * Lines of every length between 0 and 150 bytes, so that line ends fall
+     * on every position of the 64 byte scan windows.
+     */
+    std::string data;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 150; ++i)
+    {
+        std::string line(i, 'a' + i%26);
+        expected.push_back(line);
+        data += line;
+        data += (i % 3 == 0) ? "\r\n" : "\n";
+    }
+    data += "last";
+    expected.push_back("last");
+
+    std::shared_ptr<io::error::error> err;
+    io::LineReader reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    for (const std::string &line : expected)
+    {
+        char *got = reader.next_line(err);
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_NE(got, nullptr);
+        ASSERT_EQ(line, got);
+    }
+    ASSERT_EQ(reader.next_line(err), nullptr);
+    ASSERT_FALSE(err);
+}
+
+TEST(csv, double_quote_escape)
+{
+    /*
+     * The long column makes the quoted region span several 64 byte blocks.
+     */
+    std::string long_col(150, 'x');
+    std::string data =
+        "a,b,c\n"
+        "\"1,2\",\"say \"\"hi\"\"\",plain\n"
+        "\"" + long_col + ",\"\"" + long_col + "\",,\"\"\n"
+        "x\"y,z\"w,b,\",\"\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b", "c"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::string a,b,c;
+    ASSERT_TRUE(reader.read_row(err, a,b,c));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(a, "1,2");
+    ASSERT_EQ(b, "say \"hi\"");
+    ASSERT_EQ(c, "plain");
+
+    ASSERT_TRUE(reader.read_row(err, a,b,c));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(a, long_col + ",\"" + long_col);
+    ASSERT_EQ(b, "");
+    ASSERT_EQ(c, "");
+
+    /* Quotes in the middle of a column also protect separators */
+    ASSERT_TRUE(reader.read_row(err, a,b,c));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(a, "x\"y,z\"w");
+    ASSERT_EQ(b, "b");
+    ASSERT_EQ(c, ",");
+}
+
+TEST(csv, double_quote_escape_short_lines)
+{
+    /*
+     * Many lines share a 64 byte block. Comments and broken rows leave a
+     * quote open in front of the next line, which must not leak into it.
+     */
+    std::string data = "a,b,c\n";
+    std::vector<std::string> expected;
+    std::size_t bad_rows = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i % 7 == 3)
+        {
+            data += "# a \"comment\n";
+        }
+        if (i % 11 == 5)
+        {
+            data += "\"" + std::to_string(i) + ",x\n";
+            ++bad_rows;
+        }
+        std::string a = "k" + std::to_string(i) + ",";
+        std::string b = std::string(i % 5, 'q') + "\"";
+        data += "\"" + a + "\",\"" + b + "\"\"," + std::to_string(i);
+        if (i != 999)
+        {
+            data += i % 2 ? "\r\n" : "\n";
+        }
+        expected.push_back(a + "|" + b + "|" + std::to_string(i));
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3, io::trim_chars<' '>, io::double_quote_escape<',', '"'>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>, io::skip_bad_rows<>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b", "c"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::vector<std::string> rows;
+    std::string a, b, c;
+    while (reader.read_row(err, a, b, c))
+    {
+        rows.push_back(a + "|" + b + "|" + c);
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(rows, expected);
+    ASSERT_EQ(reader.get_bad_row_count(io::error::code::escaped_string_not_closed), bad_rows);
+}
+
+TEST(csv, double_quote_escape_crlf)
+{
+    /*
+     * The last column ends in front of the '\r', which is overwritten
+     * after the block holding the line may have been classified.
+     */
+    std::string data = "a,b,c\r\n";
+    std::vector<std::string> expected;
+    for (int i = 0; i < 200; ++i)
+    {
+        switch (i % 4)
+        {
+        case 0:
+            data += std::to_string(i) + ",x,\"\"\"q" + std::to_string(i) + "\"\r\n";
+            expected.push_back("\"q" + std::to_string(i));
+            break;
+        case 1:
+            data += std::to_string(i) + ",x,\"" + std::to_string(i) + "\"\r\n";
+            expected.push_back(std::to_string(i));
+            break;
+        case 2:
+            data += std::to_string(i) + ",x,z" + std::to_string(i) + "  \r\n";
+            expected.push_back("z" + std::to_string(i));
+            break;
+        default:
+            data += std::to_string(i) + ",x,\r\n";
+            expected.push_back("");
+        }
+    }
+
+    temp_file file;
+    FILE *f = std::fopen(file.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(std::fwrite(data.data(), 1, data.size(), f), data.size());
+    ASSERT_EQ(std::fclose(f), 0);
+
+    typedef io::CSVReader<3, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> reader_type;
+    std::shared_ptr<io::error::error> err;
+    std::unique_ptr<reader_type> readers[] = {
+        std::unique_ptr<reader_type>(new reader_type(err, "mem.csv", data.data(), data.data() + data.size())),
+        std::unique_ptr<reader_type>(new reader_type(err, file.c_str()))
+    };
+    ASSERT_FALSE(err) << err->get_error();
+
+    for (auto &reader : readers)
+    {
+        ASSERT_TRUE(reader->read_header(err, io::ignore_no_column, "a", "b", "c"));
+        ASSERT_FALSE(err) << err->get_error();
+
+        std::vector<std::string> columns;
+        char *a, *b, *c;
+        while (reader->read_row(err, a, b, c))
+        {
+            columns.push_back(c);
+        }
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_EQ(columns, expected);
+    }
+}
+
+TEST(csv, double_quote_escape_not_closed)
+{
+    std::string data = "a,b\n1,\"2" + std::string(100, ',') + "\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::string a,b;
+    ASSERT_FALSE(reader.read_row(err, a,b));
+    ASSERT_TRUE(err);
+
+    ASSERT_EQ(
+        err->get_error(),
+        "Escaped string was not closed in line 2 in file mem.csv");
+}
+
+TEST(csv, many_blocks)
+{
+    /* Several MiB, so that the reader has to refill its buffer a few times */
+    std::string data = "a,b\n";
+    const int row_count = 400000;
+    for (int i = 0; i < row_count; ++i)
+    {
+        data += std::to_string(i) + "," + std::to_string(2*i) + "\n";
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a,b;
+    int expected = 0;
+    while (reader.read_row(err, a,b))
+    {
+        ASSERT_EQ(a, expected);
+        ASSERT_EQ(b, 2*expected);
+        ++expected;
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(expected, row_count);
+}
+
+TEST(csv, io_uring)
+{
+    /* Large enough that every read is split into several pieces */
+    const int row_count = 400000;
+    temp_file uring;
+    {
+        FILE *file = std::fopen(uring.c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        std::fputs("a,b\n", file);
+        for (int i = 0; i < row_count; ++i)
+        {
+            std::fprintf(file, "%d,%d\n", i, 2*i);
+        }
+        std::fclose(file);
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, uring.c_str(), io::io_uring);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a,b;
+    int expected = 0;
+    while (reader.read_row(err, a,b))
+    {
+        ASSERT_EQ(a, expected);
+        ASSERT_EQ(b, 2*expected);
+        ++expected;
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(expected, row_count);
+}
+
+TEST(csv, io_uring_cannot_open_file)
+{
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<4> reader(err, "-1.csv", io::io_uring);
+    ASSERT_TRUE(err);
+
+    ASSERT_EQ(
+        err->get_error(),
+        "Can not open file \"-1.csv\" because \"No such file or directory\".");
+}
+
+#ifdef CSV_IO_THREAD
+
+static void write_parallel_test_file(const char *file_name, int row_count, int bad_row)
+{
+    FILE *file = std::fopen(file_name, "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("# comment\nb,a\n", file);
+    for (int i = 0; i < row_count; ++i)
+    {
+        if (i == bad_row)
+        {
+            std::fputs("x,1\n", file);
+        }
+        else
+        {
+            std::fprintf(file, "%d,%d\n", 2*i, i);
+        }
+    }
+    std::fclose(file);
+}
+
+TEST(csv, parallel_in_file_order)
+{
+    temp_file parallel;
+    const int row_count = 100000;
+    write_parallel_test_file(parallel.c_str(), row_count, -1);
+
+    std::shared_ptr<io::error::error> err;
+    io::ParallelCSVReader<2, io::trim_chars<' '>, io::no_quote_escape<','>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>> reader(err, parallel.c_str(), 4, 4096);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int expected = 0;
+    bool in_order = true;
+    bool ok = reader.for_each_row<int, int>(
+        err,
+        [&](int a, int b)
+        {
+            in_order = in_order && a == expected && b == 2*expected;
+            ++expected;
+        });
+    ASSERT_TRUE(ok);
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_TRUE(in_order);
+    ASSERT_EQ(expected, row_count);
+}
+
+TEST(csv, parallel_any_order)
+{
+    temp_file parallel;
+    const int row_count = 100000;
+    write_parallel_test_file(parallel.c_str(), row_count, -1);
+
+    std::shared_ptr<io::error::error> err;
+    io::ParallelCSVReader<2, io::trim_chars<' '>, io::no_quote_escape<','>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>> reader(err, parallel.c_str(), 4, 4096);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::vector<bool> seen(row_count, false);
+    bool ok = reader.for_each_row<int, std::string>(
+        err,
+        [&](int a, const std::string &b)
+        {
+            if (a >= 0 && a < row_count && b == std::to_string(2*a))
+            {
+                seen[a] = true;
+            }
+        },
+        io::any_order);
+    ASSERT_TRUE(ok);
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(std::count(seen.begin(), seen.end(), true), row_count);
+}
+
+TEST(csv, parallel_error_line)
+{
+    temp_file parallel;
+    write_parallel_test_file(parallel.c_str(), 50000, 31234);
+
+    std::shared_ptr<io::error::error> err;
+    io::ParallelCSVReader<2, io::trim_chars<' '>, io::no_quote_escape<','>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>> reader(err, parallel.c_str(), 4, 4096);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int row_count = 0;
+    bool ok = reader.for_each_row<int, int>(err, [&](int, int) { ++row_count; });
+    ASSERT_FALSE(ok);
+    ASSERT_TRUE(err);
+    ASSERT_EQ(row_count, 31234);
+
+    ASSERT_EQ(
+        err->get_error(),
+        std::string("The integer x contains an invalid digit in column b in file ") +
+        parallel.c_str() + " in line 31237");
+}
+
+TEST(csv, parallel_aggregate)
+{
+    temp_file parallel;
+    const int row_count = 100000;
+    write_parallel_test_file(parallel.c_str(), row_count, -1);
+
+    std::shared_ptr<io::error::error> err;
+    io::ParallelCSVReader<2, io::trim_chars<' '>, io::no_quote_escape<','>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>> reader(err, parallel.c_str(), 4, 4096);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    io::column_aggregate<int> a;
+    io::column_aggregate<double> b;
+    ASSERT_TRUE(reader.aggregate(err, a, b));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(a.get_count(), static_cast<std::size_t>(row_count));
+    ASSERT_EQ(a.get_sum(), static_cast<long long>(row_count)*(row_count-1)/2);
+    ASSERT_EQ(a.get_min(), 0);
+    ASSERT_EQ(a.get_max(), row_count-1);
+    ASSERT_EQ(b.get_count(), static_cast<std::size_t>(row_count));
+    ASSERT_EQ(b.get_sum(), static_cast<double>(row_count)*(row_count-1));
+    ASSERT_EQ(b.get_max(), 2.0*(row_count-1));
+
+    write_parallel_test_file(parallel.c_str(), 50000, 31234);
+    io::ParallelCSVReader<2, io::trim_chars<' '>, io::no_quote_escape<','>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>> broken(err, parallel.c_str(), 4, 4096);
+    ASSERT_TRUE(broken.read_header(err, io::ignore_no_column, "a", "b"));
+    io::column_aggregate<int> c;
+    io::column_aggregate<int> d;
+    ASSERT_FALSE(broken.aggregate(err, c, d));
+    ASSERT_TRUE(err);
+    ASSERT_EQ(
+        err->get_error(),
+        std::string("The integer x contains an invalid digit in column b in file ") +
+        parallel.c_str() + " in line 31237");
+    ASSERT_EQ(c.get_count(), 31234u);
+    ASSERT_EQ(c.get_max(), 31233);
+}
+
+#endif
+
+TEST(csv, byte_range)
+{
+    const int row_count = 5000;
+    temp_file range;
+    {
+        FILE *file = std::fopen(range.c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        std::fputs("b,a\n", file);
+        for (int i = 0; i < row_count; ++i)
+        {
+            std::fprintf(file, "%d,%d\n", 2*i, i);
+        }
+        std::fclose(file);
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> header(err, range.c_str());
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_TRUE(header.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(header.get_byte_offset(), 4);
+
+    FILE *file = std::fopen(range.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::fseek(file, 0, SEEK_END);
+    long long file_size = std::ftell(file);
+    std::fclose(file);
+
+    /*
+     * Split points in the middle of lines, directly at line starts and
+     * directly behind newlines.
+     */
+    long long data_begin = header.get_byte_offset();
+    std::vector<long long> split = {data_begin, data_begin + 1, 100, 107, 108, 20000, 20001, file_size};
+
+    int expected = 0;
+    for (std::size_t i = 0; i + 1 < split.size(); ++i)
+    {
+        io::CSVReader<2> part(err, range.c_str(), io::byte_range(split[i], split[i+1]));
+        ASSERT_FALSE(err) << err->get_error();
+        part.copy_header(header);
+
+        int a,b;
+        while (part.read_row(err, a,b))
+        {
+            ASSERT_EQ(a, expected);
+            ASSERT_EQ(b, 2*expected);
+            ++expected;
+        }
+        ASSERT_FALSE(err) << err->get_error();
+    }
+    ASSERT_EQ(expected, row_count);
+}
+
+TEST(csv, long_lines)
+{
+    /* Lines that take several doublings of the initial 1 MiB buffer */
+    std::string long_a(5<<20, 'x');
+    std::string long_b(3<<20, 'y');
+    std::string data = "a,b\n1,2\n" + long_a + ",3\n4,5\n6," + long_b;
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::string a,b;
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, "1");
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, long_a);
+    ASSERT_EQ(b, "3");
+    ASSERT_EQ(reader.get_byte_offset(), 8 + static_cast<long long>(long_a.size()) + 3);
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, "4");
+    ASSERT_EQ(reader.get_file_line(), 4u);
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, "6");
+    ASSERT_EQ(b, long_b);
+    ASSERT_FALSE(reader.read_row(err, a,b));
+    ASSERT_FALSE(err) << err->get_error();
+}
+
+TEST(csv, line_length_limit_exceeded)
+{
+    std::string data = "a,b\n1,2\n" + std::string(101, 'x') + ",3\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+    reader.set_max_line_length(102);
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::string a,b;
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_FALSE(reader.read_row(err, a,b));
+    ASSERT_TRUE(err);
+
+    ASSERT_EQ(
+        err->get_error(),
+        "Line number 3 in file \"mem.csv\" exceeds the maximum length of 102 characters.");
+}
+
+TEST(csv, block_len)
+{
+    std::string data = "a,b\n";
+    const int row_count = 2000;
+    for (int i = 0; i < row_count; ++i)
+    {
+        data += std::to_string(i) + "," + (i == 1000 ? std::string(300, 'x') : std::to_string(2*i)) + "\n";
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "mem.csv", data.data(), data.data() + data.size(), 100);
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(reader.get_block_len(), 128);
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a;
+    std::string b;
+    int expected = 0;
+    while (reader.read_row(err, a,b))
+    {
+        ASSERT_EQ(a, expected);
+        ASSERT_EQ(b, expected == 1000 ? std::string(300, 'x') : std::to_string(2*expected));
+        ++expected;
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(expected, row_count);
+    ASSERT_EQ(reader.get_block_len(), 512);
+}
+
+TEST(csv, ring_buffer_wraps)
+{
+    /*
+     * A page sized block wraps the ring buffer many times, and lines of
+     * varying length straddle every block boundary.
+     */
+    std::string data = "a,b\n";
+    const int row_count = 20000;
+    for (int i = 0; i < row_count; ++i)
+    {
+        data += std::to_string(i) + "," + std::string(i % 97, 'z') + "\n";
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "mem.csv", data.data(), data.data() + data.size(), 4096);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a;
+    std::string b;
+    int expected = 0;
+    while (reader.read_row(err, a,b))
+    {
+        ASSERT_EQ(a, expected);
+        ASSERT_EQ(b, std::string(expected % 97, 'z'));
+        ++expected;
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(expected, row_count);
+}
+
+TEST(csv, float_round_trip)
+{
+    const double values[] = {
+        0.1, 1.0/3, 2.2250738585072014e-308, 4.9406564584124654e-324,
+        3.4028234663852886e38, 9007199254740993.0, 123456.789e-20, 5e-324};
+
+    std::string data = "a,b\n";
+    char text[64];
+    for (double value : values)
+    {
+        std::snprintf(text, sizeof(text), "%.17g", value);
+        data += text;
+        std::snprintf(text, sizeof(text), ",%.9g\n", static_cast<double>(static_cast<float>(value)));
+        data += text;
+    }
+    /* More than 19 significant digits, a decimal comma and a halfway case */
+    data += "0.1000000000000000055511151231257827021181583404541015625,\"1,5\"\n";
+    data += "9007199254740993,16777217\n";
+    data += "1.7976931348623157e308,3.4028235e38\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    double a;
+    float b;
+    for (double value : values)
+    {
+        ASSERT_TRUE(reader.read_row(err, a,b));
+        ASSERT_EQ(a, value);
+        ASSERT_EQ(b, static_cast<float>(value));
+    }
+
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, 0.1);
+    ASSERT_EQ(b, 1.5f);
+
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, 9007199254740992.0);
+    ASSERT_EQ(b, 16777216.0f);
+
+    ASSERT_TRUE(reader.read_row(err, a,b));
+    ASSERT_EQ(a, (std::numeric_limits<double>::max)());
+    ASSERT_EQ(b, (std::numeric_limits<float>::max)());
+
+    ASSERT_FALSE(reader.read_row(err, a,b));
+    ASSERT_FALSE(err) << err->get_error();
+}
+
+TEST(csv, read_rows)
+{
+    std::string data = "a,b,c\n# comment\n";
+    for (int i = 0; i < 10; ++i)
+    {
+        data += std::to_string(i) + ",x" + std::to_string(i) + "," + std::to_string(i) + ".5\n";
+    }
+    data += "10,x10,oops\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3, io::trim_chars<' '>, io::no_quote_escape<','>,
+        io::set_to_max_on_overflow, io::single_line_comment<'#'>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b", "c"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::vector<int> a;
+    std::vector<std::string> b;
+    std::vector<double> c;
+    ASSERT_EQ(reader.read_rows(err, 4, a,b,c), 4u);
+    ASSERT_EQ(reader.read_rows(err, 4, a,b,c), 4u);
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_EQ(reader.read_rows(err, 4, a,b,c), 2u);
+    ASSERT_TRUE(err);
+    ASSERT_EQ(
+        err->get_error(),
+        "The integer oops contains an invalid digit in column c in file mem.csv in line 13");
+
+    ASSERT_EQ(a.size(), 10u);
+    ASSERT_EQ(b.size(), 10u);
+    ASSERT_EQ(c.size(), 10u);
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_EQ(a[i], i);
+        ASSERT_EQ(b[i], "x" + std::to_string(i));
+        ASSERT_EQ(c[i], i + 0.5);
+    }
+}
+
+#ifdef CSV_IO_ARROW
+
+TEST(csv, arrow_batch)
+{
+    std::string data = "id,name,score\n";
+    for (int i = 0; i < 10; ++i)
+    {
+        data += std::to_string(i) + ",n" + std::to_string(i) + "," + (i % 3 == 0 ? "" : std::to_string(i) + ".25") + "\n";
+    }
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<4> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_missing_column, "id", "name", "score", "missing"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    ArrowArray array;
+    ArrowSchema schema;
+    std::size_t rows = reader.read_arrow_batch<long long, std::string, double, int>(err, 8, &array, &schema);
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(rows, 8u);
+
+    ASSERT_STREQ(schema.format, "+s");
+    ASSERT_EQ(schema.n_children, 4);
+    ASSERT_STREQ(schema.children[0]->format, "l");
+    ASSERT_STREQ(schema.children[0]->name, "id");
+    ASSERT_STREQ(schema.children[1]->format, "u");
+    ASSERT_STREQ(schema.children[2]->format, "g");
+    ASSERT_STREQ(schema.children[3]->format, "i");
+    ASSERT_STREQ(schema.children[3]->name, "missing");
+
+    ASSERT_EQ(array.length, 8);
+    ASSERT_EQ(array.n_children, 4);
+
+    const ArrowArray *id = array.children[0];
+    ASSERT_EQ(id->null_count, 0);
+    const long long *ids = static_cast<const long long*>(id->buffers[1]);
+
+    const ArrowArray *name = array.children[1];
+    const std::int32_t *offsets = static_cast<const std::int32_t*>(name->buffers[1]);
+    const char *chars = static_cast<const char*>(name->buffers[2]);
+
+    const ArrowArray *score = array.children[2];
+    ASSERT_EQ(score->null_count, 3);
+    const std::uint8_t *valid = static_cast<const std::uint8_t*>(score->buffers[0]);
+    const double *scores = static_cast<const double*>(score->buffers[1]);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(ids[i], i);
+        ASSERT_EQ(std::string(chars + offsets[i], chars + offsets[i+1]), "n" + std::to_string(i));
+        ASSERT_EQ(((valid[i/8] >> (i%8)) & 1) != 0, i % 3 != 0);
+        if (i % 3 != 0)
+        {
+            ASSERT_EQ(scores[i], i + 0.25);
+        }
+    }
+
+    ASSERT_EQ(array.children[3]->null_count, 8);
+
+    array.release(&array);
+    schema.release(&schema);
+    ASSERT_EQ(array.release, nullptr);
+
+    rows = reader.read_arrow_batch<long long, std::string, double, int>(err, 8, &array);
+    ASSERT_EQ(rows, 2u);
+    ASSERT_EQ(array.length, 2);
+    array.release(&array);
+
+    rows = reader.read_arrow_batch<long long, std::string, double, int>(err, 8, &array);
+    ASSERT_EQ(rows, 0u);
+    ASSERT_EQ(array.release, nullptr);
+    ASSERT_FALSE(err) << err->get_error();
+}
+
+#endif
+
+TEST(csv, ignore_trailing_columns)
+{
+    std::string data =
+        "a,b,c,d,e\n"
+        "1,x,2,y,z\n"
+        "3,x,4,y,z,more,columns\n"
+        "5,x,6\n"
+        "7,x,8,\"not closed\n"
+        "9,x\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(
+        err, io::ignore_extra_column | io::ignore_trailing_columns, "c", "a"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a, c;
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(reader.read_row(err, c,a));
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_EQ(a, 2*i + 1);
+        ASSERT_EQ(c, 2*i + 2);
+    }
+
+    ASSERT_FALSE(reader.read_row(err, c,a));
+    ASSERT_TRUE(err);
+    ASSERT_EQ(err->get_error(), "Too few columns in line 6 in file \"mem.csv\"");
+}
+
+TEST(csv, filters)
+{
+    const std::string ok = "completed successfully after retry";
+    std::string data = "pad,status,ts,value\n";
+    int expected = 0;
+    long long expected_sum = 0;
+    for (int i = 0; i < 300; ++i)
+    {
+        std::string status = ok;
+        if (i % 3 == 1)
+        {
+            status[i % ok.size()] = 'X';
+        }
+        else if (i % 3 == 2)
+        {
+            status = (i % 2) ? ok.substr(0, i % ok.size()) : ok + "!";
+        }
+        long long ts = i * 7 % 100;
+        data += std::string(i % 67, 'p') + ",\"" + status + "\"," + std::to_string(ts) + "," + std::to_string(i) + "\n";
+        if (i % 3 == 0 && ts >= 50)
+        {
+            ++expected;
+            expected_sum += i;
+        }
+    }
+    data += "p,other,oops,1\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> reader(
+        err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_TRUE(reader.read_header(err, io::ignore_extra_column, "status", "ts", "value"));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_FALSE(reader.add_filter("pad", io::field_equals("p")));
+    ASSERT_TRUE(reader.add_filter("status", io::field_equals(ok)));
+    ASSERT_TRUE(reader.add_filter("ts", io::field_greater_equal<long long>(50)));
+
+    char *status = nullptr;
+    long long ts;
+    int value;
+    int count = 0;
+    long long sum = 0;
+    while (reader.read_row(err, status, ts, value))
+    {
+        ASSERT_EQ(std::string(status), ok);
+        ASSERT_GE(ts, 50);
+        ++count;
+        sum += value;
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(count, expected);
+    ASSERT_EQ(sum, expected_sum);
+
+    io::field_not_equals not_ok(ok);
+    ASSERT_TRUE(not_ok("completed"));
+    ASSERT_FALSE(not_ok(ok.c_str()));
+    ASSERT_TRUE(io::field_less<int>(3)("2"));
+    ASSERT_FALSE(io::field_less<int>(3)("x"));
+    ASSERT_FALSE(io::field_greater_equal<long long>(-5)(""));
+    ASSERT_FALSE(io::field_less<double>(1.0)(""));
+}
+
+TEST(csv, aggregate)
+{
+    std::string data =
+        "a,b,c\n"
+        "1,-2.5,10\n"
+        "7,,20\n"
+        "-4,1.5,30\n"
+        "3,4,x\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<3> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_TRUE(reader.read_header(err, io::ignore_missing_column | io::ignore_extra_column, "a", "b", "d"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    io::column_aggregate<int> a;
+    io::column_aggregate<double> b;
+    io::column_aggregate<unsigned> d;
+    ASSERT_TRUE(reader.aggregate(err, a, b, d));
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_EQ(a.get_count(), 4u);
+    ASSERT_EQ(a.get_sum(), 7);
+    ASSERT_EQ(a.get_min(), -4);
+    ASSERT_EQ(a.get_max(), 7);
+    ASSERT_EQ(a.get_mean(), 1.75);
+    ASSERT_EQ(b.get_count(), 3u);
+    ASSERT_EQ(b.get_sum(), 3.0);
+    ASSERT_EQ(b.get_min(), -2.5);
+    ASSERT_EQ(b.get_max(), 4.0);
+    ASSERT_EQ(d.get_count(), 0u);
+    ASSERT_TRUE(std::isnan(d.get_mean()));
+
+    io::CSVReader<2> broken(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(broken.read_header(err, io::ignore_extra_column, "a", "c"));
+    io::column_aggregate<int> a2;
+    io::column_aggregate<int> c2;
+    ASSERT_FALSE(broken.aggregate(err, a2, c2));
+    ASSERT_TRUE(err);
+    ASSERT_EQ(a2.get_count(), 3u);
+    ASSERT_EQ(c2.get_sum(), 60);
+}
+
+TEST(csv, group_by)
+{
+    std::string data = "region,amount,product,ignored,weight\n";
+    std::map<std::string, std::pair<long long, int>> expected;
+    for (int i = 0; i < 50000; ++i)
+    {
+        std::string region = "r" + std::to_string(i % 7);
+        std::string product = "product_" + std::to_string(i * 7919 % 3001);
+        int amount = i % 100 - 20;
+        data += region + "," + std::to_string(amount) + "," + product + ",x," + std::to_string(amount + 20) + ".25\n";
+        auto e = expected.emplace(region + "/" + product, std::make_pair(0LL, amount)).first;
+        e->second.first += amount;
+        e->second.second = std::max(e->second.second, amount);
+    }
+
+    typedef io::hash_group_by<2, int, long double> group_type;
+    const std::size_t default_budget = group_type::default_memory_budget;
+    for (std::size_t budget : {default_budget, std::size_t(1)<<17})
+    {
+        std::shared_ptr<io::error::error> err;
+        io::CSVReader<4> reader(err, "mem.csv", data.data(), data.data() + data.size());
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_TRUE(reader.read_header(err, io::ignore_extra_column, "region", "product", "amount", "weight"));
+        ASSERT_FALSE(err) << err->get_error();
+
+        group_type groups(budget);
+        ASSERT_TRUE(reader.group_by(err, groups));
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_EQ(groups.has_spilled(), budget != default_budget);
+
+        std::size_t count = 0;
+        bool matches = true;
+        ASSERT_TRUE(groups.for_each_group(
+            err,
+            [&](const char *const *keys, const io::column_aggregate<int> &amount,
+                const io::column_aggregate<long double> &weight)
+            {
+                auto e = expected.find(std::string(keys[0]) + "/" + keys[1]);
+                matches = matches && e != expected.end() &&
+                    amount.get_sum() == e->second.first &&
+                    amount.get_max() == e->second.second &&
+                    weight.get_count() == amount.get_count() &&
+                    weight.get_sum() == static_cast<long double>(amount.get_sum()) + 20.25L*amount.get_count();
+                ++count;
+            }));
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_TRUE(matches);
+        ASSERT_EQ(count, expected.size());
+        ASSERT_EQ(groups.get_group_count(), 0u);
+    }
+}
+
+TEST(csv, sort_rows)
+{
+    std::string data = "# comment\nname,value,tag\n";
+    std::vector<std::tuple<std::string, int, std::string>> rows;
+    for (int i = 0; i < 20000; ++i)
+    {
+        std::string name = "n" + std::to_string(i * 37 % 101);
+        int value = i * 7919 % 13;
+        std::string line = "\"" + name + "\"," + std::to_string(value) + ",\"t," + std::to_string(i) + "\"";
+        data += line + "\n";
+        rows.emplace_back(name, value, line);
+    }
+    std::stable_sort(
+        rows.begin(), rows.end(),
+        [](const std::tuple<std::string, int, std::string> &a, const std::tuple<std::string, int, std::string> &b)
+        {
+            return std::tie(std::get<1>(a), std::get<0>(a)) < std::tie(std::get<1>(b), std::get<0>(b));
+        });
+    std::string expected = "name,value,tag\n";
+    for (const auto &r : rows)
+    {
+        expected += std::get<2>(r) + "\n";
+    }
+
+    temp_file sorted_file;
+    for (std::size_t budget : {std::size_t(1)<<28, std::size_t(1)<<12})
+    {
+        std::shared_ptr<io::error::error> err;
+        io::CSVReader<2, io::trim_chars<' '>, io::double_quote_escape<',', '"'>,
+            io::set_to_max_on_overflow, io::single_line_comment<'#'>> reader(
+            err, "mem.csv", data.data(), data.data() + data.size());
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_TRUE(reader.read_header(err, io::ignore_extra_column, "value", "name"));
+        ASSERT_FALSE(err) << err->get_error();
+
+        ASSERT_TRUE((reader.sort_rows<int, std::string>(err, sorted_file.c_str(), budget)));
+        ASSERT_FALSE(err) << err->get_error();
+
+        std::string sorted;
+        FILE *file = std::fopen(sorted_file.c_str(), "rb");
+        ASSERT_NE(file, nullptr);
+        char buffer[4096];
+        std::size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+        {
+            sorted.append(buffer, n);
+        }
+        std::fclose(file);
+        ASSERT_EQ(sorted, expected);
+    }
+}
+
+TEST(csv, hash_join)
+{
+    std::string dim = "id,name\n";
+    for (int i = 0; i < 3000; ++i)
+    {
+        dim += "\"k" + std::to_string(i % 2000) + "\",name" + std::to_string(i) + "\n";
+    }
+    std::string events = "ts,user\n";
+    for (int i = 0; i < 20000; ++i)
+    {
+        events += std::to_string(i) + ",k" + std::to_string(i * 31 % 2500) + "\n";
+    }
+
+    std::vector<std::string> expected;
+    for (int i = 0; i < 20000; ++i)
+    {
+        int key = i * 31 % 2500;
+        for (int j = key; j < 3000 && key < 2000; j += 2000)
+        {
+            expected.push_back(std::to_string(i) + " name" + std::to_string(j));
+        }
+    }
+
+    for (std::size_t budget : {io::default_join_memory_budget, std::size_t(1)<<18, std::size_t(1)<<17})
+    {
+        std::shared_ptr<io::error::error> err;
+        io::CSVReader<2, io::trim_chars<' '>, io::double_quote_escape<',', '"'>> build(
+            err, "dim.csv", dim.data(), dim.data() + dim.size());
+        io::CSVReader<2> probe(err, "events.csv", events.data(), events.data() + events.size());
+        ASSERT_FALSE(err) << err->get_error();
+        ASSERT_TRUE(build.read_header(err, io::ignore_no_column, "id", "name"));
+        ASSERT_TRUE(probe.read_header(err, io::ignore_no_column, "user", "ts"));
+        ASSERT_FALSE(err) << err->get_error();
+
+        std::vector<std::string> joined;
+        unsigned partition_depth;
+        ASSERT_TRUE(io::hash_join(
+            err, build, probe,
+            [&](const char *const *b, const char *const *p)
+            {
+                joined.push_back(std::string(p[1]) + " " + b[1]);
+            },
+            budget, partition_depth));
+        ASSERT_FALSE(err) << err->get_error();
+
+        if (budget == io::default_join_memory_budget)
+        {
+            ASSERT_EQ(partition_depth, 0u);
+            ASSERT_TRUE(joined == expected);
+        }
+        else
+        {
+            // 1<<17 is below the memory of a table with a single row, so
+            // every partition with more than one key is partitioned again.
+            ASSERT_EQ(partition_depth > 1, budget == std::size_t(1)<<17);
+            ASSERT_GE(partition_depth, 1u);
+            std::sort(joined.begin(), joined.end());
+            std::vector<std::string> sorted_expected = expected;
+            std::sort(sorted_expected.begin(), sorted_expected.end());
+            ASSERT_TRUE(joined == sorted_expected);
+        }
+    }
+}
+
+TEST(csv, error_status)
+{
+    std::string data =
+        "a,b\n"
+        "1,2\n"
+        "3,x\n"
+        "4\n"
+        "5,6\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::CSVReader<2> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    io::error::status status;
+    ASSERT_FALSE(status.to_error());
+
+    int a, b;
+    ASSERT_TRUE(reader.read_row(status, a, b));
+    ASSERT_EQ(a, 1);
+
+    ASSERT_FALSE(reader.read_row(status, a, b));
+    ASSERT_TRUE(status);
+    ASSERT_EQ(status.get_code(), io::error::code::no_digit);
+    ASSERT_EQ(status.get_file_line(), 3);
+    ASSERT_STREQ(status.get_column_name(), "b");
+    ASSERT_STREQ(status.get_column_content(), "x");
+    ASSERT_EQ(
+        status.to_error()->get_error(),
+        "The integer x contains an invalid digit in column b in file mem.csv in line 3");
+
+    ASSERT_FALSE(reader.read_row(status, a, b));
+    status.clear();
+    ASSERT_FALSE(reader.read_row(status, a, b));
+    ASSERT_EQ(status.get_code(), io::error::code::too_few_columns);
+    ASSERT_EQ(status.to_error()->get_error(), "Too few columns in line 4 in file \"mem.csv\"");
+
+    status.clear();
+    ASSERT_TRUE(reader.read_row(status, a, b));
+    ASSERT_EQ(b, 6);
+    ASSERT_FALSE(reader.read_row(status, a, b));
+    ASSERT_FALSE(status);
+}
+
+TEST(csv, skip_bad_rows)
+{
+    std::string data =
+        "a,b\n"
+        "1,2\n"
+        "3,x\n"
+        "4\n"
+        "5,6,7\n"
+        "8,-1\n"
+        "9,10\n"
+        "11,y\n";
+
+    typedef io::CSVReader<
+        2,
+        io::trim_chars<' ', '\t'>,
+        io::no_quote_escape<','>,
+        io::set_to_max_on_overflow,
+        io::no_comment,
+        io::skip_bad_rows<3>> reader_type;
+
+    std::shared_ptr<io::error::error> err;
+    reader_type reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    int a;
+    unsigned b;
+    ASSERT_TRUE(reader.read_row(err, a, b));
+    ASSERT_EQ(a, 1);
+    ASSERT_TRUE(reader.read_row(err, a, b));
+    ASSERT_EQ(a, 9);
+    ASSERT_EQ(b, 10u);
+    ASSERT_FALSE(reader.read_row(err, a, b));
+    ASSERT_FALSE(err) << err->get_error();
+
+    ASSERT_EQ(reader.get_bad_row_count(), 5u);
+    ASSERT_EQ(reader.get_bad_row_count(io::error::code::no_digit), 2u);
+    ASSERT_EQ(reader.get_bad_row_count(io::error::code::too_few_columns), 1u);
+    ASSERT_EQ(reader.get_bad_row_count(io::error::code::too_many_columns), 1u);
+    ASSERT_EQ(reader.get_bad_row_count(io::error::code::integer_must_be_positive), 1u);
+    ASSERT_EQ(reader.get_bad_row_lines(), (std::vector<unsigned>{3, 4, 5}));
+
+    reader_type batch(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(batch.read_header(err, io::ignore_no_column, "a", "b"));
+    std::vector<int> as;
+    std::vector<unsigned> bs;
+    io::error::status status;
+    ASSERT_EQ(batch.read_rows(status, 10, as, bs), 2u);
+    ASSERT_FALSE(status);
+    ASSERT_EQ(as, (std::vector<int>{1, 9}));
+    ASSERT_EQ(batch.get_bad_row_count(), 5u);
+
+    std::string long_line = "a,b\n" + std::string(101, '1') + ",2\n";
+    reader_type too_long(err, "mem.csv", long_line.data(), long_line.data() + long_line.size());
+    too_long.set_max_line_length(102);
+    ASSERT_TRUE(too_long.read_header(err, io::ignore_no_column, "a", "b"));
+    ASSERT_FALSE(too_long.read_row(err, a, b));
+    ASSERT_TRUE(err);
+    ASSERT_EQ(err->get_code(), io::error::code::line_length_limit_exceeded);
+}
+
+TEST(csv, no_error_check)
+{
+    std::string data =
+        "a,b,c\n"
+        "1,-2,x\n"
+        "+30,400000,y\n"
+        "5,6\n";
+
+    typedef io::CSVReader<
+        3,
+        io::trim_chars<' ', '\t'>,
+        io::no_quote_escape<','>,
+        io::set_to_max_on_overflow,
+        io::no_comment,
+        io::no_error_check> reader_type;
+
+    std::shared_ptr<io::error::error> err;
+    reader_type reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(reader.read_header(err, io::ignore_no_column, "a", "b", "c"));
+    ASSERT_FALSE(err) << err->get_error();
+
+    unsigned char a;
+    long long b;
+    std::string c;
+    ASSERT_TRUE(reader.read_row(err, a, b, c));
+    ASSERT_EQ(a, 1);
+    ASSERT_EQ(b, -2);
+    ASSERT_EQ(c, "x");
+
+    std::vector<unsigned char> as;
+    std::vector<long long> bs;
+    std::vector<std::string> cs;
+    ASSERT_EQ(reader.read_rows(err, 10, as, bs, cs), 1u);
+    ASSERT_EQ(as[0], 30);
+    ASSERT_EQ(bs[0], 400000);
+    ASSERT_EQ(cs[0], "y");
+
+    ASSERT_TRUE(err);
+    ASSERT_EQ(err->get_code(), io::error::code::too_few_columns);
+}
+
+TEST(csv, dynamic_reader)
+{
+    std::string data =
+        "name,id,score,extra\n"
+        "x, 1,2.5,a\n"
+        "y,-2,,b\n"
+        "z,3,oops,c\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::DynamicCSVReader<> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_FALSE(err) << err->get_error();
+
+    std::vector<io::column_spec> columns;
+    columns.push_back(io::column_spec{"id", io::column_type::signed_integer});
+    columns.push_back(io::column_spec{"score", io::column_type::floating_point});
+    columns.push_back(io::column_spec{"name", io::column_type::text});
+    columns.push_back(io::column_spec{"missing", io::column_type::unsigned_integer});
+    ASSERT_TRUE(reader.read_header(err, io::ignore_extra_column | io::ignore_missing_column, columns));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_TRUE(reader.has_column("score"));
+    ASSERT_FALSE(reader.has_column("missing"));
+    ASSERT_FALSE(reader.has_column("extra"));
+
+    io::error::status status;
+    io::field_span row;
+    ASSERT_TRUE(reader.read_row(status, row));
+    ASSERT_EQ(row.size(), 4u);
+    ASSERT_EQ(row[0].get_signed_integer(), 1);
+    ASSERT_EQ(row[1].get_floating_point(), 2.5);
+    ASSERT_STREQ(row[2].get_text(), "x");
+    ASSERT_TRUE(row[3].is_missing());
+    ASSERT_EQ(row[3].get_unsigned_integer(), 0u);
+    ASSERT_EQ(row[0].get_type(), io::column_type::signed_integer);
+    ASSERT_EQ(row[2].get_type(), io::column_type::text);
+    ASSERT_EQ(row[3].get_type(), io::column_type::unsigned_integer);
+    const io::field_view *fields = row.begin();
+
+    ASSERT_TRUE(reader.read_row(status, row));
+    ASSERT_EQ(row.begin(), fields);
+    ASSERT_EQ(row[0].get_signed_integer(), -2);
+    ASSERT_STREQ(row[1].get_text(), "");
+
+    ASSERT_FALSE(reader.read_row(status, row));
+    ASSERT_EQ(status.get_code(), io::error::code::no_digit);
+    ASSERT_EQ(status.get_file_line(), 4);
+    ASSERT_STREQ(status.get_column_name(), "score");
+
+    io::DynamicCSVReader<> from_header(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(from_header.read_header(err, io::column_type::text));
+    ASSERT_EQ(from_header.get_column_count(), 4u);
+    ASSERT_EQ(from_header.get_column_name(3), "extra");
+    from_header.set_column_type(1, io::column_type::signed_integer);
+    std::vector<long long> ids;
+    while (from_header.read_row(err, row))
+    {
+        ids.push_back(row[1].get_signed_integer());
+        ASSERT_EQ(row[3].get_text()[0] - 'a', static_cast<int>(ids.size()) - 1);
+    }
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_EQ(ids, (std::vector<long long>{1, -2, 3}));
+}
+
+TEST(csv, wide_header)
+{
+    std::string header;
+    std::string line;
+    std::vector<io::column_spec> columns;
+    for (int i = 0; i < 2000; ++i)
+    {
+        header += (i == 0 ? "" : ",") + ("sensor_" + std::to_string(i));
+        line += (i == 0 ? "" : ",") + std::to_string(i);
+        if (i % 2 == 0)
+        {
+            columns.push_back(io::column_spec{"sensor_" + std::to_string(1999 - i), io::column_type::signed_integer});
+        }
+    }
+    columns.push_back(io::column_spec{"absent", io::column_type::text});
+    std::string data = header + "\n" + line + "\n";
+
+    std::shared_ptr<io::error::error> err;
+    io::DynamicCSVReader<> reader(err, "mem.csv", data.data(), data.data() + data.size());
+    ASSERT_TRUE(reader.read_header(err, io::ignore_extra_column | io::ignore_missing_column, columns));
+    ASSERT_FALSE(err) << err->get_error();
+    ASSERT_TRUE(reader.has_column("sensor_1"));
+    ASSERT_FALSE(reader.has_column("sensor_0"));
+    ASSERT_FALSE(reader.has_column("absent"));
+    ASSERT_EQ(reader.get_column_index("sensor_1"), 999);
+    ASSERT_EQ(reader.get_column_index("absent"), 1000);
+    ASSERT_EQ(reader.get_column_index("sensor_0"), -1);
+
+    io::field_span row;
+    ASSERT_TRUE(reader.read_row(err, row));
+    ASSERT_EQ(row[0].get_signed_integer(), 1999);
+    ASSERT_EQ(row[999].get_signed_integer(), 1);
+    ASSERT_TRUE(row[1000].is_missing());
+
+    std::string duplicated = header + ",sensor_7\n";
+    io::CSVReader<2> in(err, "mem.csv", duplicated.data(), duplicated.data() + duplicated.size());
+    ASSERT_FALSE(in.read_header(err, io::ignore_extra_column, "sensor_3", "sensor_7"));
+    ASSERT_TRUE(err);
+    ASSERT_EQ(err->get_code(), io::error::code::duplicated_column_in_header);
+}